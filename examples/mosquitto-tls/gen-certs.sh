@@ -0,0 +1,49 @@
+#!/bin/bash
+# Generate a self-signed CA + broker certificate for testing MQTT over TLS
+# Usage: ./gen-certs.sh [broker-ip-or-hostname]
+#
+# Uses EC P-256 keys: an ECDHE-ECDSA handshake is several times cheaper on
+# the ESP32-S3 than RSA-2048.
+
+set -e
+
+BROKER=${1:-"192.168.1.100"}
+DAYS=825
+OUT=certs
+
+mkdir -p "$OUT"
+cd "$OUT"
+
+echo "Generating CA..."
+openssl ecparam -name prime256v1 -genkey -noout -out ca.key
+openssl req -x509 -new -key ca.key -sha256 -days $DAYS \
+    -subj "/CN=PosturePilot Test CA" -out ca.crt
+
+echo "Generating broker certificate for $BROKER..."
+openssl ecparam -name prime256v1 -genkey -noout -out server.key
+openssl req -new -key server.key -subj "/CN=$BROKER" -out server.csr
+
+# mbedTLS on the ESP32 matches the hostname against the CN, so CN must be
+# exactly what MQTT_SERVER is set to. SAN is added for other clients.
+if [[ "$BROKER" =~ ^[0-9.]+$ ]]; then
+    SAN="IP:$BROKER"
+else
+    SAN="DNS:$BROKER"
+fi
+printf "subjectAltName=%s\n" "$SAN" > server.ext
+
+openssl x509 -req -in server.csr -CA ca.crt -CAkey ca.key -CAcreateserial \
+    -days $DAYS -sha256 -extfile server.ext -out server.crt
+
+rm -f server.csr server.ext ca.srl
+
+echo ""
+echo "Done. Files in $(pwd):"
+echo "  ca.crt      -> paste into MQTT_CA_CERT in config.h"
+echo "  server.crt  -> mosquitto certfile"
+echo "  server.key  -> mosquitto keyfile"
+echo ""
+echo "config.h snippet:"
+echo "#define MQTT_CA_CERT \\"
+sed 's/.*/    "&\\n" \\/' ca.crt
+echo '    ""'
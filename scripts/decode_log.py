@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+PosturePilot Binary Log Decoder
+
+Expands the compact records written by the firmware's deferred logger
+(src/log.cpp, LOG_OUTPUT_BINARY or LOG_MQTT) back into text. Format strings
+aren't sent over the wire - each record carries the flash address of its
+format string, which is looked up in the firmware ELF.
+
+Usage:
+    # Live from the serial port
+    python decode_log.py --elf ../.pio/build/xiao_esp32s3/firmware.elf --port /dev/ttyACM0
+
+    # From a capture file (or stdin with "-")
+    python decode_log.py --elf firmware.elf --file capture.bin
+
+    # From MQTT (needs mosquitto_sub)
+    mosquitto_sub -h 192.168.1.100 -t posture-pilot/log -N | python decode_log.py --elf firmware.elf --file -
+
+Plain text on the same serial port (boot messages etc.) is passed through.
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<2sBBBBII")  # sync, level, nargs, types, pad, ts_ms, fmt
+LEVELS = "DIWE"
+
+ARG_INT, ARG_UINT, ARG_FLOAT, ARG_STR = range(4)
+
+# printf conversion spec: flags, width, precision, length modifier, conversion
+SPEC_RE = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z|j|t|L)?([diouxXcsfeEgGp%])")
+
+
+class ElfStrings:
+    """Reads NUL-terminated strings from the allocated sections of an ELF."""
+
+    def __init__(self, path: str):
+        try:
+            from elftools.elf.elffile import ELFFile
+        except ImportError:
+            print("Error: pyelftools not installed (pip install pyelftools)")
+            sys.exit(1)
+
+        self.sections = []
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for sec in elf.iter_sections():
+                # SHF_ALLOC, with file contents
+                if sec["sh_flags"] & 0x2 and sec["sh_type"] != "SHT_NOBITS" and sec["sh_size"]:
+                    self.sections.append((sec["sh_addr"], sec.data()))
+        self.cache = {}
+
+    def get(self, addr: int):
+        if addr in self.cache:
+            return self.cache[addr]
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                off = addr - base
+                end = data.find(b"\0", off)
+                s = data[off:end if end >= 0 else len(data)].decode("utf-8", "replace")
+                self.cache[addr] = s
+                return s
+        return None
+
+
+def format_record(strings: ElfStrings, fmt_addr: int, types: int, args):
+    fmt = strings.get(fmt_addr)
+    if fmt is None:
+        return f"<unknown format 0x{fmt_addr:08x}> " + " ".join(f"0x{a:08x}" for a in args)
+
+    idx = 0
+
+    def convert(m):
+        nonlocal idx
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            return "%"
+        if idx >= len(args):
+            return "?"
+        raw, kind = args[idx], (types >> (idx * 2)) & 0x3
+        idx += 1
+
+        if kind == ARG_FLOAT:
+            value = struct.unpack("<f", struct.pack("<I", raw))[0]
+        elif kind == ARG_INT:
+            value = struct.unpack("<i", struct.pack("<I", raw))[0]
+        elif kind == ARG_STR:
+            value = strings.get(raw) or f"<ptr 0x{raw:08x}>"
+        else:
+            value = raw
+
+        if conv == "s":
+            return ("%" + flags + "s") % value
+        if conv == "p":
+            return f"0x{raw:08x}"
+        if conv in "feEgG":
+            return ("%" + flags + conv) % float(value) if not isinstance(value, str) else value
+        if isinstance(value, str):
+            return value
+        # Python has no %u; unsigned values were already decoded as such
+        return ("%" + flags + ("d" if conv in "iu" else conv)) % int(value)
+
+    return SPEC_RE.sub(convert, fmt).rstrip("\n")
+
+
+class Decoder:
+    """Incremental frame decoder; passes through anything that isn't a frame."""
+
+    def __init__(self, strings: ElfStrings, out):
+        self.strings = strings
+        self.out = out
+        self.buf = b""
+
+    def feed(self, data: bytes):
+        self.buf += data
+        while self._step():
+            pass
+        self.out.flush()
+
+    def _text(self, data: bytes):
+        if data:
+            self.out.write(data.decode("utf-8", "replace"))
+
+    def _step(self) -> bool:
+        buf = self.buf
+        pos = buf.find(SYNC)
+        if pos < 0:
+            # Keep a possible partial sync byte for the next chunk
+            keep = 1 if buf.endswith(SYNC[:1]) else 0
+            self._text(buf[:len(buf) - keep])
+            self.buf = buf[len(buf) - keep:]
+            return False
+        if pos > 0:
+            self._text(buf[:pos])
+            buf = self.buf = buf[pos:]
+
+        if len(buf) < HEADER.size:
+            return False
+        _, level, nargs, types, _, ts, fmt_addr = HEADER.unpack_from(buf)
+        if nargs > 4:
+            # Not actually a frame - emit the sync bytes as text and move on
+            self._text(buf[:2])
+            self.buf = buf[2:]
+            return True
+        size = HEADER.size + 4 * nargs
+        if len(buf) < size:
+            return False
+        args = list(struct.unpack_from(f"<{nargs}I", buf, HEADER.size))
+        self.buf = buf[size:]
+
+        tag = LEVELS[level] if level < len(LEVELS) else "?"
+        if fmt_addr == 0:
+            line = f"[log] {args[0] if args else '?'} records dropped"
+        else:
+            line = format_record(self.strings, fmt_addr, types, args)
+        self.out.write(f"[{ts} {tag}] {line}\n")
+        return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode PosturePilot binary logs")
+    parser.add_argument("--elf", required=True, help="firmware.elf matching the running firmware")
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="Serial port to read from")
+    src.add_argument("--file", help="Capture file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    decoder = Decoder(ElfStrings(args.elf), sys.stdout)
+
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            print("Error: pyserial not installed (pip install pyserial)")
+            sys.exit(1)
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        try:
+            while True:
+                data = port.read(4096)
+                if data:
+                    decoder.feed(data)
+        except KeyboardInterrupt:
+            pass
+    else:
+        f = sys.stdin.buffer if args.file == "-" else open(args.file, "rb")
+        for chunk in iter(lambda: f.read(4096), b""):
+            decoder.feed(chunk)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""
+PosturePilot Synthetic Trace Generator
+
+Writes a .pptr frame trace from a posture script, for simulator runs and
+escalation regression tests without a device recording.
+
+Each segment is `good:SECONDS`, `bad:SECONDS` or `away:SECONDS` (no frames,
+e.g. the device was off). Confidences get a little noise so thresholds are
+exercised the way real model output does.
+
+Usage:
+    # One workday: mostly good, a few long slouches
+    python make_trace.py --out day.pptr --script "good:3600,bad:700,good:1800,bad:200" --repeat 4
+
+Format: see src/trace.h
+"""
+
+import argparse
+import random
+import struct
+
+RECORD_HEADER = struct.Struct("<4sIHHfI")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate synthetic PosturePilot traces")
+    parser.add_argument("--out", required=True, help="Output .pptr file")
+    parser.add_argument("--script", required=True, help="Comma-separated good/bad/away:SECONDS segments")
+    parser.add_argument("--repeat", type=int, default=1, help="Repeat the script N times")
+    parser.add_argument("--fps", type=float, default=5.0)
+    parser.add_argument("--size", default="16x12", help="Frame size WxH (content is synthetic)")
+    parser.add_argument("--noise", type=float, default=0.08, help="Confidence noise (std dev)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    w, h = (int(v) for v in args.size.lower().split("x"))
+    segments = []
+    for part in args.script.split(","):
+        kind, secs = part.split(":")
+        if kind not in ("good", "bad", "away"):
+            parser.error(f"unknown segment kind: {kind}")
+        segments.append((kind, float(secs)))
+
+    interval_ms = 1000.0 / args.fps
+    t = 0.0
+    frames = 0
+    with open(args.out, "wb") as out:
+        out.write(b"PPTR" + struct.pack("<HH", 1, 0))
+        for _ in range(args.repeat):
+            for kind, secs in segments:
+                end = t + secs * 1000
+                if kind == "away":
+                    t = end
+                    continue
+                base = 0.15 if kind == "good" else 0.85
+                shade = 90 if kind == "good" else 160
+                pixels = bytes([shade]) * (w * h)
+                while t < end:
+                    conf = min(1.0, max(0.0, rng.gauss(base, args.noise)))
+                    out.write(RECORD_HEADER.pack(b"PPFR", int(t) & 0xFFFFFFFF, w, h, conf, w * h))
+                    out.write(pixels)
+                    frames += 1
+                    t += interval_ms
+
+    print(f"Wrote {frames} frames ({t / 3600000:.2f} h) to {args.out}")
+
+
+if __name__ == "__main__":
+    main()
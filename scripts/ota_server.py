@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+PosturePilot OTA Server
+
+Minimal local stand-in for an update server: serves a directory over HTTP
+with single-range Range request support (which Python's http.server lacks).
+
+--drop-rate cuts that fraction of responses off half way, to exercise the
+device's retry/resume path.
+
+Usage:
+    python ota_server.py --dir ./ota [--port 8070] [--drop-rate 0.2]
+"""
+
+import argparse
+import functools
+import os
+import random
+import re
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+
+RANGE_RE = re.compile(r"bytes=(\d*)-(\d*)$")
+
+
+class RangeHandler(SimpleHTTPRequestHandler):
+    drop_rate = 0.0
+
+    def send_head(self):
+        self.range_left = None
+        rng = self.headers.get("Range")
+        if not rng:
+            return super().send_head()
+
+        path = self.translate_path(self.path)
+        if os.path.isdir(path):
+            return super().send_head()
+        try:
+            f = open(path, "rb")
+        except OSError:
+            self.send_error(404, "File not found")
+            return None
+
+        size = os.fstat(f.fileno()).st_size
+        m = RANGE_RE.match(rng.strip())
+        if not m or (not m.group(1) and not m.group(2)):
+            f.close()
+            self.send_error(416, "Unsupported range")
+            return None
+
+        if m.group(1):
+            start = int(m.group(1))
+            end = int(m.group(2)) if m.group(2) else size - 1
+        else:
+            # Suffix range: last N bytes
+            start = max(0, size - int(m.group(2)))
+            end = size - 1
+        end = min(end, size - 1)
+        if start > end:
+            f.close()
+            self.send_response(416)
+            self.send_header("Content-Range", f"bytes */{size}")
+            self.end_headers()
+            return None
+
+        self.send_response(206)
+        self.send_header("Content-Type", self.guess_type(path))
+        self.send_header("Content-Range", f"bytes {start}-{end}/{size}")
+        self.send_header("Content-Length", str(end - start + 1))
+        self.send_header("Accept-Ranges", "bytes")
+        self.end_headers()
+
+        f.seek(start)
+        self.range_left = end - start + 1
+        return f
+
+    def copyfile(self, source, outputfile):
+        left = self.range_left
+        if left is None:
+            return super().copyfile(source, outputfile)
+
+        if random.random() < self.drop_rate:
+            left //= 2
+            self.close_connection = True
+            self.log_message("dropping response after %d bytes", left)
+        while left > 0:
+            chunk = source.read(min(left, 16384))
+            if not chunk:
+                break
+            outputfile.write(chunk)
+            left -= len(chunk)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Serve PosturePilot OTA packages")
+    parser.add_argument("--dir", default="./ota", help="Directory written by pack_ota.py")
+    parser.add_argument("--port", type=int, default=8070)
+    parser.add_argument("--drop-rate", type=float, default=0.0,
+                        help="Fraction of range responses to truncate (testing)")
+    args = parser.parse_args()
+
+    RangeHandler.drop_rate = args.drop_rate
+    handler = functools.partial(RangeHandler, directory=args.dir)
+    server = ThreadingHTTPServer(("0.0.0.0", args.port), handler)
+    print(f"Serving {args.dir} on port {args.port} (Ctrl+C to stop)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+PosturePilot OTA Packer
+
+Splits a firmware image into fixed-size blocks, raw-deflate compresses each
+block independently and writes the container plus a manifest for the
+device's pull updater (src/updater.cpp).
+
+Independent blocks mean the device can verify, write and checkpoint one
+block at a time, and resume a broken download with an HTTP Range request
+for the next block instead of starting over.
+
+The manifest carries the image's FIRMWARE_BUILD (src/updater.h), read from
+the image itself. The device only takes builds newer than its own.
+
+Usage:
+    python pack_ota.py --image ../.pio/build/xiao_esp32s3/firmware.bin --out ./ota
+    python ota_server.py --dir ./ota
+    mosquitto_pub -h 192.168.1.100 -t posture-pilot/ota/update -m http://192.168.1.10:8070/manifest.json
+
+Signing (needed when the firmware has OTA_PUBLIC_KEY set):
+    openssl ecparam -name prime256v1 -genkey -noout -out ota_key.pem
+    openssl ec -in ota_key.pem -pubout      # paste into OTA_PUBLIC_KEY
+    python pack_ota.py --image ... --out ./ota --key ota_key.pem
+
+Output:
+    ota/firmware.ppota      - concatenated compressed blocks
+    ota/manifest.json       - image size/SHA-256, per-block offset/length/SHA-256
+    ota/manifest.json.sig   - hex DER ECDSA P-256/SHA-256 signature (--key only)
+"""
+
+import argparse
+import hashlib
+import json
+import re
+import sys
+import zlib
+from pathlib import Path
+
+BLOCK_SIZE_DEFAULT = 64 * 1024
+MAX_BLOCKS = 96                 # UPDATER_MAX_BLOCKS in src/updater.cpp
+BUILD_TAG = re.compile(rb"PPBUILD=(\d+)\0")
+
+
+def pack(image: bytes, block_size: int):
+    blocks = []
+    payload = bytearray()
+    for off in range(0, len(image), block_size):
+        raw = image[off:off + block_size]
+        # wbits=-15: raw deflate, no zlib header - what the ROM inflater expects
+        comp = zlib.compressobj(9, zlib.DEFLATED, -15)
+        data = comp.compress(raw) + comp.flush()
+        blocks.append({
+            "offset": len(payload),
+            "length": len(data),
+            "sha256": hashlib.sha256(raw).hexdigest(),
+        })
+        payload += data
+    return blocks, bytes(payload)
+
+
+def sign(data: bytes, key_path: str) -> str:
+    # Only needed for --key, so don't make it a hard dependency
+    from cryptography.hazmat.primitives import hashes, serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+
+    key = serialization.load_pem_private_key(Path(key_path).read_bytes(), password=None)
+    if not isinstance(key, ec.EllipticCurvePrivateKey) or key.curve.name != "secp256r1":
+        print(f"Error: {key_path} is not an ECDSA P-256 private key")
+        sys.exit(1)
+    return key.sign(data, ec.ECDSA(hashes.SHA256())).hex()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack firmware for PosturePilot pull OTA")
+    parser.add_argument("--image", required=True, help="firmware.bin from the PlatformIO build")
+    parser.add_argument("--out", default="./ota", help="Output directory")
+    parser.add_argument("--block-size", type=int, default=BLOCK_SIZE_DEFAULT,
+                        help="Uncompressed block size (multiple of 4096)")
+    parser.add_argument("--version", default="", help="Free-form version string for the manifest")
+    parser.add_argument("--key", help="ECDSA P-256 private key (PEM) to sign the manifest with")
+    args = parser.parse_args()
+
+    if args.block_size <= 0 or args.block_size % 4096:
+        print("Error: --block-size must be a positive multiple of 4096 (flash sector)")
+        sys.exit(1)
+
+    image = Path(args.image).read_bytes()
+    if not image or image[0] != 0xE9:
+        print(f"Error: {args.image} doesn't look like an ESP32 app image")
+        sys.exit(1)
+
+    tag = BUILD_TAG.search(image)
+    if not tag:
+        print(f"Error: {args.image} has no build tag (PPBUILD=, src/updater.cpp)")
+        sys.exit(1)
+    build = int(tag.group(1))
+
+    block_count = (len(image) + args.block_size - 1) // args.block_size
+    if block_count > MAX_BLOCKS:
+        print(f"Error: {block_count} blocks, the device takes at most {MAX_BLOCKS} - "
+              f"use a larger --block-size")
+        sys.exit(1)
+
+    blocks, payload = pack(image, args.block_size)
+
+    out = Path(args.out)
+    out.mkdir(parents=True, exist_ok=True)
+    (out / "firmware.ppota").write_bytes(payload)
+
+    manifest = {
+        "version": args.version,
+        "build": build,
+        "compression": "deflate",
+        "url": "firmware.ppota",
+        "image_size": len(image),
+        "image_sha256": hashlib.sha256(image).hexdigest(),
+        "block_size": args.block_size,
+        "blocks": blocks,
+    }
+    manifest_bytes = json.dumps(manifest, indent=1).encode()
+    (out / "manifest.json").write_bytes(manifest_bytes)
+    if args.key:
+        (out / "manifest.json.sig").write_text(sign(manifest_bytes, args.key) + "\n")
+
+    ratio = len(payload) / len(image)
+    print(f"Image:   {len(image):,} bytes, build {build}, {len(blocks)} blocks of "
+          f"{args.block_size // 1024} KB")
+    print(f"Packed:  {len(payload):,} bytes ({ratio:.0%} of original)")
+    print(f"Written: {out / 'firmware.ppota'}, {out / 'manifest.json'}"
+          + (f", {out / 'manifest.json.sig'}" if args.key else ""))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+PosturePilot Trace Recorder
+
+Receives the frame trace a device streams with TRACE_RECORD enabled and
+writes it to a .pptr file for the host simulator. The device reconnects
+after WiFi drops or reboots; later connections are appended to the same
+file (the simulator bridges the timestamp reset).
+
+Usage:
+    python record_trace.py --out workday.pptr [--port 8072]
+
+Format: see src/trace.h
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+FILE_HEADER = 8
+RECORD_HEADER = struct.Struct("<4sIHHfI")
+
+
+def read_exact(conn, n):
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = conn.recv(n - len(buf))
+        if not chunk:
+            return None
+        buf += chunk
+    return bytes(buf)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Record PosturePilot frame traces")
+    parser.add_argument("--out", required=True, help="Output .pptr file")
+    parser.add_argument("--port", type=int, default=8072)
+    args = parser.parse_args()
+
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind(("0.0.0.0", args.port))
+    srv.listen(1)
+    print(f"Waiting for device on port {args.port} (Ctrl+C to stop)")
+
+    frames = 0
+    wrote_header = False
+    with open(args.out, "wb") as out:
+        try:
+            while True:
+                conn, addr = srv.accept()
+                print(f"Device connected from {addr[0]}")
+                header = read_exact(conn, FILE_HEADER)
+                if not header or header[:4] != b"PPTR":
+                    print("Not a trace stream, dropping connection")
+                    conn.close()
+                    continue
+                if not wrote_header:
+                    out.write(header)
+                    wrote_header = True
+
+                start = time.time()
+                while True:
+                    rec = read_exact(conn, RECORD_HEADER.size)
+                    if rec is None:
+                        break
+                    magic, ts, w, h, conf, length = RECORD_HEADER.unpack(rec)
+                    if magic != b"PPFR" or length != w * h:
+                        print("Corrupt record, dropping connection")
+                        break
+                    data = read_exact(conn, length)
+                    if data is None:
+                        break
+                    out.write(rec + data)
+                    frames += 1
+                    if frames % 100 == 0:
+                        rate = frames / max(time.time() - start, 1e-3)
+                        print(f"\r{frames} frames ({w}x{h}, conf={conf:.2f}, {rate:.1f} fps)", end="")
+                        sys.stdout.flush()
+                conn.close()
+                out.flush()
+                print(f"\nDevice disconnected, {frames} frames so far")
+        except KeyboardInterrupt:
+            pass
+
+    print(f"\nWrote {frames} frames to {args.out}")
+
+
+if __name__ == "__main__":
+    main()
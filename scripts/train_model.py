@@ -7,16 +7,58 @@
 
 Usage:
     python train_model.py --data ./data --output ../src/model.h
+    python train_model.py --data dataset.tar    # from the device's /export
+    python train_model.py --data ./data --incremental   # fine-tune on what's new
+    python train_model.py --data ./data --search --accuracy-floor 0.9
+    python train_model.py --data ./data --mac-budget 5e6 --qat
+    python train_model.py --data dataset.json   # packed by the native packer
 
 Data structure:
     data/
       good/    <- images of good posture
       bad/     <- images of bad posture
+
+A tar from /export or /burst has the same layout and is unpacked to a
+temporary directory first. .pgm samples (COLLECT_TENSOR) are used as the
+model input directly, without resizing. A dataset.json/.u8 pair from the
+native packer (pio run -e packer) is memory-mapped as it is: decoded,
+resized with the firmware's own code and deduplicated already.
+
+Samples are always decoded at the model's input size: --input-size, the
+previous model's with --incremental, the packed dataset's, or else
+MODEL_INPUT_WIDTH from the config.h next to --output. JPEGs are resized
+once from the source image; PGMs and packed datasets must already be at
+that size, since resizing them again would no longer match the device.
+
+Decoded samples are cached by file hash and size (model.samples.96.npz), and the Keras
+checkpoint, INT8 calibration set and the list of trained samples are saved
+next to model.tflite. --incremental starts from that checkpoint and
+fine-tunes for a few epochs on the new samples plus a replay of old ones,
+instead of training from scratch.
+
+--search trains a small grid of architectures (width, depthwise-separable
+blocks, 64 or 96 input), scores each exported INT8 model on validation
+accuracy and benchmarked invoke time, prints the Pareto front and exports
+the fastest one above --accuracy-floor. --device-ms calibrates the host
+benchmark to the invoke time the device reports for the current model.
+
+--mac-budget / --latency-budget prune whole conv filters (smallest L1
+norm first) until the model fits, fine-tuning between steps, and --qat
+fine-tunes with fake quantization before the INT8 export. The export is
+the same plain INT8 .tflite either way.
 """
 
 import argparse
+import atexit
+import hashlib
+import json
 import os
+import re
+import shutil
 import sys
+import tarfile
+import tempfile
+import time
 import numpy as np
 from pathlib import Path
 
@@ -26,59 +68,273 @@
 from tensorflow import keras
 from tensorflow.keras import layers
 
-IMG_WIDTH = 96
-IMG_HEIGHT = 96
+INPUT_SIZE_DEFAULT = 96             # Without a config.h: MODEL_INPUT_WIDTH/HEIGHT in config.example.h
 BATCH_SIZE = 32
 EPOCHS_DEFAULT = 30
+CLASS_NAMES = ["bad", "good"]       # Firmware assumes bad=0, good=1
+IMAGE_SUFFIXES = (".jpg", ".jpeg", ".png", ".bmp", ".pgm")
+VALIDATION_BUCKETS = 5              # 1 in 5 samples (by file hash) validates
+CALIBRATION_SAMPLES = 250           # INT8 representative images
+
+# --incremental
+FINETUNE_EPOCHS = 5
+FINETUNE_LR = 1e-4
+REPLAY_RATIO = 3                    # Old samples replayed per new sample
+REPLAY_MIN = 200
+
+# --search
+SEARCH_WIDTHS = [0.25, 0.5, 1.0]
+SEARCH_SEPARABLE = [False, True]
+SEARCH_INPUTS = [64, 96]
+SEARCH_EPOCHS = 15
+BENCHMARK_RUNS = 50
+
+# --mac-budget / --latency-budget / --qat
+PRUNE_STEPS = 3                     # Prune gradually, fine-tuning after each step
+PRUNE_EPOCHS = 3
+PRUNE_MIN_FILTERS = 4
+QAT_EPOCHS = 5
+QAT_LR = 1e-4
+
+
+def unpack_tar(tar_path: str) -> str:
+    """Extract the good/ and bad/ images of a dataset tar to a temp dir."""
+    out = tempfile.mkdtemp(prefix="posture-data-")
+    # The dataset is read lazily during training, so keep it until exit
+    atexit.register(shutil.rmtree, out, ignore_errors=True)
+
+    count = 0
+    with tarfile.open(tar_path) as tar:
+        for member in tar:
+            parts = Path(member.name).parts
+            if not member.isfile() or len(parts) != 2 or parts[0] not in ("good", "bad"):
+                continue  # metadata.csv, anything unexpected
+            dest = Path(out) / parts[0] / parts[1]
+            dest.parent.mkdir(exist_ok=True)
+            with tar.extractfile(member) as src, open(dest, "wb") as dst:
+                shutil.copyfileobj(src, dst)
+            count += 1
+    print(f"Unpacked {count} images from {tar_path}")
+    return out
+
+def read_pgm(data: bytes, name: str) -> np.ndarray:
+    """Parse a binary 8-bit PGM (P5) into a (height, width) uint8 array."""
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos) + 1
+            continue
+        end = pos
+        while end < len(data) and not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    pos += 1  # Single whitespace before the pixels
+
+    if fields[0] != b"P5" or int(fields[3]) != 255:
+        raise ValueError(f"{name}: not an 8-bit binary PGM")
+    width, height = int(fields[1]), int(fields[2])
+    return np.frombuffer(data, np.uint8, width * height, pos).reshape(height, width)
+
+
+def config_input_size(output_path: str) -> int:
+    """MODEL_INPUT_WIDTH/HEIGHT from the config.h next to the model header."""
+    config = Path(output_path).parent / "config.h"
+    if not config.exists():
+        return INPUT_SIZE_DEFAULT
+    text = config.read_text()
+    size = [re.search(rf"#define\s+MODEL_INPUT_{dim}\s+(\d+)", text) for dim in ("WIDTH", "HEIGHT")]
+    if not all(size):
+        return INPUT_SIZE_DEFAULT
+    width, height = int(size[0].group(1)), int(size[1].group(1))
+    if width != height:
+        print(f"Error: {config} has a {width}x{height} model input, it must be square")
+        sys.exit(1)
+    return width
+
+
+def decode_sample(data: bytes, name: str, size: int) -> np.ndarray:
+    """Decode one image file to the (size, size) uint8 model input."""
+    if name.lower().endswith(".pgm"):
+        # COLLECT_TENSOR: already the model input the firmware computes, so
+        # it's used as-is - no decode or resize that could differ from the device
+        img = read_pgm(data, name)
+        if img.shape != (size, size):
+            raise ValueError(f"{name}: {img.shape[1]}x{img.shape[0]}, expected {size}x{size} "
+                             f"(collect at this MODEL_INPUT size, or set --input-size)")
+        return img
+
+    # Same decode and bilinear resize as keras image_dataset_from_directory,
+    # rounded to 8 bits like the device's own resize. Straight from the
+    # source image at every size, never from a smaller cached sample.
+    img = tf.io.decode_image(data, channels=1, expand_animations=False)
+    img = tf.image.resize(img, (size, size), method="bilinear")
+    return np.clip(np.round(img.numpy()[..., 0]), 0, 255).astype(np.uint8)
+
+
+def load_cache(cache_path: Path, size: int) -> dict:
+    if not cache_path.exists():
+        return {}
+    with np.load(cache_path) as cache:
+        if cache["images"].shape[1:] != (size, size):
+            return {}
+        return dict(zip(cache["hashes"].tolist(), cache["images"]))
+
+
+def load_packed(index_path: str, size: int = None):
+    """
+    Dataset from src/tools/pack_dataset.cpp: the .u8 next to the index is
+    memory-mapped, not read, and its hashes are the same file SHA-1s the
+    directory loader uses, so the split and --incremental carry over.
+    """
+    with open(index_path) as f:
+        index = json.load(f)
+    if index["classes"] != CLASS_NAMES:
+        print(f"Error: {index_path} has classes {index['classes']}, expected {CLASS_NAMES}")
+        sys.exit(1)
+    # Packed at MODEL_INPUT_WIDTH/HEIGHT from the packer's config.h
+    width, height = index["width"], index["height"]
+    if width != height:
+        print(f"Error: {index_path} is {width}x{height}, the model input must be square")
+        sys.exit(1)
+    if size and size != width:
+        raise ValueError(f"{index_path}: packed at {width}x{height}, expected {size}x{size} "
+                         f"(repack with MODEL_INPUT_WIDTH/HEIGHT {size})")
+
+    images = np.memmap(Path(index_path).with_suffix(".u8"), dtype=np.uint8, mode="r",
+                       shape=(index["count"], height, width, 1))
+    labels = np.array(index["labels"])
+    print(f"Classes: {CLASS_NAMES}")
+    print(f"Samples: {len(labels)} ({np.sum(labels == 1)} good, {np.sum(labels == 0)} bad), "
+          f"{width}x{height}")
+    return index["sha1"], images, labels
+
+
+def load_dataset(data_dir: str, cache_path: Path, size: int):
+    """
+    Load images from good/ and bad/ subdirectories (or a dataset tar), or
+    a packed dataset, at size x size. A packed dataset has its own size,
+    which a size of None takes.
 
+    Decoded samples are cached by file content hash in cache_path (one file
+    per size), so a rerun only decodes files it hasn't seen (renamed files
+    are still hits, and a frame that is both in a /burst and an /export tar
+    counts once).
 
-def load_dataset(data_dir: str, validation_split: float = 0.2):
-    """Load images from good/ and bad/ subdirectories."""
+    Returns (hashes, images (N, H, W, 1) uint8, labels (N,) with bad=0, good=1).
+    Raises ValueError if samples can't be had at that size.
+    """
+    if data_dir.endswith(".json"):
+        return load_packed(data_dir, size)
+    if os.path.isfile(data_dir) and tarfile.is_tarfile(data_dir):
+        data_dir = unpack_tar(data_dir)
     data_path = Path(data_dir)
 
     if not (data_path / "good").exists() or not (data_path / "bad").exists():
         print(f"Error: Expected {data_path}/good/ and {data_path}/bad/ directories")
         sys.exit(1)
 
-    train_ds = keras.utils.image_dataset_from_directory(
-        data_path,
-        validation_split=validation_split,
-        subset="training",
-        seed=42,
-        image_size=(IMG_HEIGHT, IMG_WIDTH),
-        batch_size=BATCH_SIZE,
-        color_mode="grayscale",
-        label_mode="categorical",
-    )
+    cache_path = cache_path.with_suffix(f".{size}.npz")
+    cache = load_cache(cache_path, size)
+    hashes, images, labels = [], [], []
+    seen = set()
+    decoded = 0
+    for label, name in enumerate(CLASS_NAMES):
+        for path in sorted((data_path / name).iterdir()):
+            if path.suffix.lower() not in IMAGE_SUFFIXES:
+                continue
+            data = path.read_bytes()
+            digest = hashlib.sha1(data).hexdigest()
+            if digest in seen:
+                continue
+            seen.add(digest)
+
+            img = cache.get(digest)
+            if img is None:
+                img = decode_sample(data, str(path), size)
+                cache[digest] = img
+                decoded += 1
+            hashes.append(digest)
+            images.append(img)
+            labels.append(label)
+
+    if not images:
+        print(f"Error: no images in {data_path}/good/ or {data_path}/bad/")
+        sys.exit(1)
 
-    val_ds = keras.utils.image_dataset_from_directory(
-        data_path,
-        validation_split=validation_split,
-        subset="validation",
-        seed=42,
-        image_size=(IMG_HEIGHT, IMG_WIDTH),
-        batch_size=BATCH_SIZE,
-        color_mode="grayscale",
-        label_mode="categorical",
-    )
+    if decoded:
+        np.savez(cache_path, hashes=np.array(list(cache.keys())),
+                 images=np.stack(list(cache.values())))
 
-    class_names = train_ds.class_names
-    print(f"Classes: {class_names}")
-    print(f"Training batches: {len(train_ds)}")
-    print(f"Validation batches: {len(val_ds)}")
+    labels = np.array(labels)
+    print(f"Classes: {CLASS_NAMES}")
+    print(f"Samples: {len(hashes)} ({np.sum(labels == 1)} good, {np.sum(labels == 0)} bad), "
+          f"{size}x{size}, {decoded} decoded, {len(hashes) - decoded} from cache")
+    return hashes, np.stack(images)[..., np.newaxis], labels
 
-    # Normalize to [0, 1]
-    norm = layers.Rescaling(1.0 / 255)
-    train_ds = train_ds.map(lambda x, y: (norm(x), y))
-    val_ds = val_ds.map(lambda x, y: (norm(x), y))
 
-    train_ds = train_ds.cache().prefetch(buffer_size=tf.data.AUTOTUNE)
-    val_ds = val_ds.cache().prefetch(buffer_size=tf.data.AUTOTUNE)
+def is_validation(digest: str) -> bool:
+    """
+    Validation membership is fixed by file hash, so a sample never moves
+    between the splits across runs - a fine-tune can't train on what the
+    previous run validated on.
+    """
+    return int(digest[:8], 16) % VALIDATION_BUCKETS == 0
 
-    return train_ds, val_ds, class_names
+
+def augmentation_layers() -> list:
+    return [
+        layers.RandomFlip("horizontal"),
+        layers.RandomRotation(0.05),
+        layers.RandomBrightness(0.1),
+    ]
+
+
+def has_augmentation(model) -> bool:
+    return any(isinstance(l, (layers.RandomFlip, layers.RandomRotation, layers.RandomBrightness))
+               for l in model.layers)
 
 
-def build_model():
+def make_dataset(images: np.ndarray, labels: np.ndarray, idx: np.ndarray,
+                 shuffle: bool = False, augment: bool = False):
+    """
+    Batches of images[idx]. The pipeline runs over the indices and each
+    batch is gathered from images when it's needed, so a memory-mapped
+    packed dataset is read a batch at a time instead of being copied into
+    RAM and into the graph as a constant (which can't exceed 2 GB).
+
+    augment: for models built without the augmentation layers (pruned,
+    QAT), which get the same augmentation here instead.
+    """
+    y = keras.utils.to_categorical(labels, len(CLASS_NAMES)).astype(np.float32)
+
+    def gather(batch):
+        # Ascending reads are sequential in the memmap; order within a batch doesn't matter
+        batch = np.sort(batch)
+        return images[batch], y[batch]
+
+    def load(batch):
+        x, yb = tf.numpy_function(gather, [batch], [tf.uint8, tf.float32])
+        x.set_shape((None,) + images.shape[1:])
+        yb.set_shape((None, len(CLASS_NAMES)))
+        # Normalize to [0, 1], same as inference.cpp
+        return tf.cast(x, tf.float32) / 255.0, yb
+
+    ds = tf.data.Dataset.from_tensor_slices(np.asarray(idx, dtype=np.int64))
+    if shuffle:
+        ds = ds.shuffle(len(idx), seed=42, reshuffle_each_iteration=True)
+    ds = ds.batch(BATCH_SIZE).map(load, num_parallel_calls=tf.data.AUTOTUNE)
+    if augment:
+        aug = keras.Sequential(augmentation_layers())
+        ds = ds.map(lambda x, y: (aug(x, training=True), y))
+    return ds.prefetch(tf.data.AUTOTUNE)
+
+
+def build_model(width: float = 1.0, separable: bool = False, input_size: int = INPUT_SIZE_DEFAULT,
+                channels: tuple = None, augment: bool = True):
     """
     CNN for 96x96 binary classification on ESP32.
 
@@ -88,33 +344,45 @@ def build_model():
     - Dropout between blocks to prevent overfitting on small datasets
     - GlobalAveragePooling instead of Flatten (way fewer params)
     - INT8 quantization friendly (no fancy ops)
+
+    --search varies it: `width` scales every layer, `separable` makes blocks
+    2 and 3 depthwise-separable (several times fewer MACs), and the input
+    can be smaller. The defaults are the architecture above.
+
+    channels (block 1, block 2, block 3, dense) overrides width - pruning
+    rebuilds with the filters it keeps. Without augment, the augmentation
+    has to come from make_dataset(augment=True).
     """
+    def filters(n):
+        return max(8, int(n * width))
+
+    conv = layers.SeparableConv2D if separable else layers.Conv2D
+    c1, c2, c3, dense = channels or (filters(32), filters(64), filters(64), filters(128))
+
     model = keras.Sequential([
-        layers.Input(shape=(IMG_HEIGHT, IMG_WIDTH, 1)),
+        layers.Input(shape=(input_size, input_size, 1)),
 
         # Data augmentation (only during training)
-        layers.RandomFlip("horizontal"),
-        layers.RandomRotation(0.05),
-        layers.RandomBrightness(0.1),
+        *(augmentation_layers() if augment else []),
 
         # Block 1: 5x5 conv to capture larger spatial patterns
-        layers.Conv2D(32, (5, 5), padding="same", activation="relu"),
+        layers.Conv2D(c1, (5, 5), padding="same", activation="relu"),
         layers.MaxPooling2D((2, 2)),
         layers.Dropout(0.2),
 
         # Block 2
-        layers.Conv2D(64, (3, 3), padding="same", activation="relu"),
+        conv(c2, (3, 3), padding="same", activation="relu"),
         layers.MaxPooling2D((2, 2)),
         layers.Dropout(0.2),
 
         # Block 3
-        layers.Conv2D(64, (3, 3), padding="same", activation="relu"),
+        conv(c3, (3, 3), padding="same", activation="relu"),
         layers.MaxPooling2D((2, 2)),
         layers.Dropout(0.2),
 
         # Classifier
         layers.GlobalAveragePooling2D(),
-        layers.Dense(128, activation="relu"),
+        layers.Dense(dense, activation="relu"),
         layers.Dropout(0.3),
         layers.Dense(2, activation="softmax"),
     ])
@@ -128,7 +396,7 @@ def build_model():
     return model
 
 
-def convert_to_tflite(model, train_ds, output_path: str):
+def quantize_model(model, calibration: np.ndarray) -> bytes:
     """Convert to fully quantized INT8 TFLite model.
 
     INT8 is much faster on ESP32 than float - no FPU needed,
@@ -136,9 +404,8 @@ def convert_to_tflite(model, train_ds, output_path: str):
     """
     # Representative dataset for INT8 calibration
     def representative_data():
-        for images, _ in train_ds.take(50):
-            for i in range(min(5, len(images))):
-                yield [tf.expand_dims(images[i], 0)]
+        for img in calibration:
+            yield [img[np.newaxis].astype(np.float32) / 255.0]
 
     converter = tf.lite.TFLiteConverter.from_keras_model(model)
 
@@ -149,7 +416,11 @@ def representative_data():
     converter.inference_input_type = tf.int8
     converter.inference_output_type = tf.int8
 
-    tflite_model = converter.convert()
+    return converter.convert()
+
+
+def convert_to_tflite(model, calibration: np.ndarray, output_path: str):
+    tflite_model = quantize_model(model, calibration)
 
     tflite_path = output_path.replace(".h", ".tflite")
     with open(tflite_path, "wb") as f:
@@ -159,7 +430,7 @@ def representative_data():
     return tflite_model
 
 
-def convert_to_header(tflite_model: bytes, output_path: str):
+def convert_to_header(tflite_model: bytes, output_path: str, input_size: int):
     """Convert TFLite model to C header for firmware embedding."""
     hex_lines = []
     for i in range(0, len(tflite_model), 12):
@@ -182,7 +453,7 @@ def convert_to_header(tflite_model: bytes, output_path: str):
 // Model size: {len(tflite_model)} bytes ({len(tflite_model) / 1024:.1f} KB)
 // Quantization: INT8 (full integer)
 //
-// Input:  96x96x1 grayscale, int8 (quantized)
+// Input:  {input_size}x{input_size}x1 grayscale, int8 (quantized)
 // Output: 2 x int8 [bad_confidence, good_confidence]
 //
 // Class order (alphabetical): bad=0, good=1
@@ -192,6 +463,10 @@ def convert_to_header(tflite_model: bytes, output_path: str):
 //
 // ============================================
 
+// Checked against MODEL_INPUT_WIDTH/HEIGHT in config.h by inference.cpp
+#define POSTURE_MODEL_INPUT_WIDTH {input_size}
+#define POSTURE_MODEL_INPUT_HEIGHT {input_size}
+
 alignas(16) const unsigned char posture_model[] = {{
 {chr(10).join(hex_lines)}
 }};
@@ -207,45 +482,527 @@ def convert_to_header(tflite_model: bytes, output_path: str):
     print(f"C header: {output_path}")
 
 
+def state_paths(output_path: str) -> dict:
+    """Training state kept next to the .tflite, for --incremental."""
+    base = Path(output_path).with_suffix("")
+    return {
+        "checkpoint": base.with_suffix(".keras"),
+        "state": base.with_suffix(".train.json"),
+        "calibration": base.with_suffix(".calib.npz"),
+        "cache": base.with_suffix(".samples.npz"),
+        "latency": base.with_suffix(".latency.json"),
+    }
+
+
+def load_state(paths: dict):
+    """Previous model, the hashes it was trained on and its calibration set,
+    or None if there's no usable state."""
+    if not all(paths[k].exists() for k in ("checkpoint", "state", "calibration")):
+        return None
+    with open(paths["state"]) as f:
+        state = json.load(f)
+    if state.get("classes") != CLASS_NAMES:
+        print("Previous model has different classes")
+        return None
+    model = keras.models.load_model(paths["checkpoint"])
+    with np.load(paths["calibration"]) as c:
+        calibration = c["images"]
+    return model, set(state["trained"]), calibration
+
+
+def save_state(paths: dict, model, trained: set, calibration: np.ndarray, val_acc: float):
+    model.save(paths["checkpoint"])
+    np.savez(paths["calibration"], images=calibration)
+    with open(paths["state"], "w") as f:
+        json.dump({
+            "input": list(model.input_shape[1:3]),
+            "classes": CLASS_NAMES,
+            "val_accuracy": round(float(val_acc), 4),
+            "trained": sorted(trained),
+        }, f)
+    print(f"Training state: {paths['checkpoint']}, {paths['state'].name}, "
+          f"{paths['calibration'].name}")
+
+
+def pick_calibration(rng, images: np.ndarray, train_idx: np.ndarray, previous=None,
+                     new_idx=None):
+    """
+    INT8 calibration images, drawn from images[train_idx]. A fine-tune keeps
+    most of the previous set and swaps in up to a quarter from
+    images[new_idx], so the quantization ranges follow new conditions
+    without a pass over the whole dataset. Only the picked samples are read.
+    """
+    if previous is None or new_idx is None:
+        n = min(CALIBRATION_SAMPLES, len(train_idx))
+        return images[rng.choice(train_idx, n, replace=False)]
+    n_new = min(len(new_idx), CALIBRATION_SAMPLES // 4)
+    n_old = min(len(previous), CALIBRATION_SAMPLES - n_new)
+    return np.concatenate([
+        previous[rng.choice(len(previous), n_old, replace=False)],
+        images[rng.choice(new_idx, n_new, replace=False)],
+    ])
+
+
+def benchmark_tflite(tflite_model: bytes, runs: int = BENCHMARK_RUNS) -> float:
+    """
+    Median invoke time in ms on one host core, with the reference kernels -
+    plain loops like TFLite Micro's, not the host's SIMD ones. Absolute
+    numbers mean little; --device-ms turns them into device time.
+    """
+    interpreter = tf.lite.Interpreter(
+        model_content=tflite_model, num_threads=1,
+        experimental_op_resolver_type=tf.lite.experimental.OpResolverType.BUILTIN_REF)
+    interpreter.allocate_tensors()
+    inp = interpreter.get_input_details()[0]
+    interpreter.set_tensor(inp["index"], np.zeros(inp["shape"], dtype=inp["dtype"]))
+    interpreter.invoke()
+    times = []
+    for _ in range(runs):
+        t = time.perf_counter()
+        interpreter.invoke()
+        times.append(time.perf_counter() - t)
+    return float(np.median(times)) * 1000
+
+
+def evaluate_tflite(tflite_model: bytes, images: np.ndarray, labels: np.ndarray,
+                    idx: np.ndarray) -> float:
+    """Accuracy of the exported INT8 model on images[idx], quantized input
+    like ModelSetInput. Reads one sample at a time."""
+    interpreter = tf.lite.Interpreter(model_content=tflite_model)
+    interpreter.allocate_tensors()
+    inp = interpreter.get_input_details()[0]
+    out = interpreter.get_output_details()[0]
+    scale, zero_point = inp["quantization"]
+    correct = 0
+    for i in idx:
+        q = np.round(images[i].astype(np.float32) / 255.0 / scale + zero_point)
+        interpreter.set_tensor(inp["index"], np.clip(q, -128, 127).astype(np.int8)[np.newaxis])
+        interpreter.invoke()
+        correct += int(np.argmax(interpreter.get_tensor(out["index"])[0]) == labels[i])
+    return correct / len(idx)
+
+
+def pareto_front(results: list) -> list:
+    """Candidates no other one beats on both latency and accuracy."""
+    return [r for r in results if not any(
+        o["ms"] <= r["ms"] and o["accuracy"] >= r["accuracy"] and
+        (o["ms"] < r["ms"] or o["accuracy"] > r["accuracy"])
+        for o in results)]
+
+
+def load_latency_factor(paths: dict):
+    """Device ms per host benchmark ms, from --device-ms, or None."""
+    if not paths["latency"].exists():
+        return None
+    with open(paths["latency"]) as f:
+        return json.load(f)["factor"]
+
+
+def calibrate_latency(paths: dict, output_path: str, device_ms: float):
+    tflite_path = Path(output_path.replace(".h", ".tflite"))
+    if not tflite_path.exists():
+        print(f"Error: {tflite_path} not found - --device-ms needs the model it was measured on")
+        sys.exit(1)
+    host_ms = benchmark_tflite(tflite_path.read_bytes())
+    factor = device_ms / host_ms
+    with open(paths["latency"], "w") as f:
+        json.dump({"device_ms": device_ms, "host_ms": round(host_ms, 4),
+                   "factor": round(factor, 4)}, f)
+    print(f"{tflite_path.name}: {host_ms:.2f} ms on this host, {device_ms:.1f} ms on the device")
+    print(f"Latency factor {factor:.2f} saved to {paths['latency'].name}")
+
+
+def search_architectures(args, datasets, labels, train_idx, val_idx, calibration_idx, factor):
+    """Train every candidate on the samples decoded at its input size
+    (datasets maps size -> images), score the INT8 exports, return the
+    chosen (model, calibration)."""
+    candidates = [(w, sep, size) for size in sorted(datasets)
+                  for sep in SEARCH_SEPARABLE for w in SEARCH_WIDTHS]
+    results = []
+    for n, (width, separable, size) in enumerate(candidates, 1):
+        name = f"{size}px w{width:g}{' sep' if separable else ''}"
+        print(f"\n[{n}/{len(candidates)}] {name}")
+        sized = datasets[size]
+        model = build_model(width, separable, size)
+        model.fit(
+            make_dataset(sized, labels, train_idx, shuffle=True),
+            validation_data=make_dataset(sized, labels, val_idx),
+            epochs=args.search_epochs,
+            callbacks=[keras.callbacks.EarlyStopping(patience=3, restore_best_weights=True)],
+            verbose=2,
+        )
+        sized_calibration = sized[calibration_idx]
+        tflite_model = quantize_model(model, sized_calibration)
+        ms = benchmark_tflite(tflite_model)
+        results.append({
+            "name": name, "model": model, "calibration": sized_calibration,
+            "accuracy": evaluate_tflite(tflite_model, sized, labels, val_idx),
+            "ms": ms * factor if factor else ms,
+            "kb": len(tflite_model) / 1024,
+        })
+
+    unit = "device ms" if factor else "host ms"
+    front = pareto_front(results)
+    print(f"\n{'Candidate':<18} {unit:>10} {'int8 acc':>9} {'size':>9}")
+    for r in sorted(results, key=lambda r: r["ms"]):
+        print(f"{r['name']:<18} {r['ms']:>10.2f} {r['accuracy']:>9.2%} "
+              f"{r['kb']:>7.1f}KB{'  *' if any(r is f for f in front) else ''}")
+    print("* Pareto front")
+    if not factor:
+        print("Host times only - run with --device-ms once to calibrate to the device")
+
+    eligible = [r for r in front if r["accuracy"] >= args.accuracy_floor]
+    if eligible:
+        chosen = min(eligible, key=lambda r: r["ms"])
+    else:
+        chosen = max(front, key=lambda r: r["accuracy"])
+        print(f"Warning: no candidate reaches {args.accuracy_floor:.0%} - taking the most accurate")
+    print(f"\nChosen: {chosen['name']} ({chosen['ms']:.2f} {unit}, {chosen['accuracy']:.2%})")
+    size = chosen["model"].input_shape[1]
+    if size != config_input_size(args.output):
+        print(f"Set MODEL_INPUT_WIDTH/HEIGHT to {size} in config.h before flashing")
+    return chosen["model"], chosen["calibration"]
+
+
+def conv_layers(model) -> list:
+    return [l for l in model.layers if isinstance(l, (layers.Conv2D, layers.SeparableConv2D))]
+
+
+def count_macs(model) -> int:
+    """Multiply-accumulates per inference, which invoke time on the device
+    tracks closely for this kind of network."""
+    macs = 0
+    for l in model.layers:
+        if isinstance(l, (layers.Conv2D, layers.SeparableConv2D)):
+            _, h, w, out_c = l.output.shape
+            in_c = l.input.shape[-1]
+            kh, kw = l.kernel_size
+            if isinstance(l, layers.SeparableConv2D):
+                macs += h * w * (kh * kw * in_c + in_c * out_c)
+            else:
+                macs += h * w * kh * kw * in_c * out_c
+        elif isinstance(l, layers.Dense):
+            macs += l.input.shape[-1] * l.units
+    return int(macs)
+
+
+def rebuild(model, keep: list):
+    """
+    Copy of model with only the filters in keep (one index array per conv
+    layer), without the augmentation layers. The inputs of the next layer
+    are sliced to match, so the smaller model starts from the same weights.
+    """
+    convs = conv_layers(model)
+    dense = [l for l in model.layers if isinstance(l, layers.Dense)]
+    separable = isinstance(convs[1], layers.SeparableConv2D)
+    pruned = build_model(separable=separable, input_size=model.input_shape[1],
+                         channels=tuple(len(k) for k in keep) + (dense[0].units,),
+                         augment=False)
+
+    prev = None
+    for src, dst, k in zip(convs, conv_layers(pruned), keep):
+        weights = src.get_weights()
+        if prev is not None:
+            weights[0] = weights[0][:, :, prev, :]
+            if isinstance(src, layers.SeparableConv2D):
+                weights[1] = weights[1][:, :, prev, :]
+        weights[-2] = weights[-2][..., k]
+        weights[-1] = weights[-1][k]
+        dst.set_weights(weights)
+        prev = k
+
+    new_dense = [l for l in pruned.layers if isinstance(l, layers.Dense)]
+    kernel, bias = dense[0].get_weights()
+    new_dense[0].set_weights([kernel[prev], bias])
+    new_dense[1].set_weights(dense[1].get_weights())
+    return pruned
+
+
+def l1_keep(model, counts: list) -> list:
+    """Indices of the counts[i] filters with the largest L1 norm per conv layer."""
+    keep = []
+    for layer, n in zip(conv_layers(model), counts):
+        # Conv2D kernel / SeparableConv2D pointwise kernel: (..., in, out)
+        norms = np.abs(layer.get_weights()[-2]).sum(axis=(0, 1, 2))
+        keep.append(np.sort(np.argsort(-norms)[:n]))
+    return keep
+
+
+def channels_for(model, ratio: float) -> list:
+    return [max(PRUNE_MIN_FILTERS, round(l.filters * ratio)) for l in conv_layers(model)]
+
+
+def prune_to_budget(model, budget: int, train_ds, val_ds):
+    """
+    Remove the same fraction of filters from every conv layer, the smallest
+    by L1 norm, until the model is within budget MACs. Done in PRUNE_STEPS
+    steps with a short fine-tune after each, which recovers more accuracy
+    than one big cut.
+    """
+    separable = isinstance(conv_layers(model)[1], layers.SeparableConv2D)
+    dense_units = [l for l in model.layers if isinstance(l, layers.Dense)][0].units
+
+    def macs_at(ratio):
+        channels = tuple(channels_for(model, ratio)) + (dense_units,)
+        return count_macs(build_model(separable=separable, input_size=model.input_shape[1],
+                                      channels=channels, augment=False))
+
+    lo, hi = 0.0, 1.0
+    for _ in range(12):
+        mid = (lo + hi) / 2
+        if macs_at(mid) <= budget:
+            lo = mid
+        else:
+            hi = mid
+    ratio = lo
+    if macs_at(ratio) > budget:
+        print(f"Warning: {PRUNE_MIN_FILTERS} filters per layer is still over budget")
+
+    original = [l.filters for l in conv_layers(model)]
+    print(f"Pruning conv filters {original} -> {channels_for(model, ratio)}")
+    for step in range(1, PRUNE_STEPS + 1):
+        counts = [max(PRUNE_MIN_FILTERS, round(n * ratio ** (step / PRUNE_STEPS)))
+                  for n in original]
+        model = rebuild(model, l1_keep(model, counts))
+        print(f"  step {step}/{PRUNE_STEPS}: {counts}, {count_macs(model) / 1e6:.2f}M MACs")
+        model.fit(train_ds, validation_data=val_ds, epochs=PRUNE_EPOCHS, verbose=2)
+    return model
+
+
+def quantization_aware(model, train_ds, val_ds, epochs: int):
+    """Fine-tune with fake INT8 quantization of weights and activations, so
+    the model learns around the rounding the export applies."""
+    try:
+        import tensorflow_model_optimization as tfmot
+    except ImportError:
+        print("Error: --qat needs tensorflow-model-optimization (pip install -r requirements.txt)")
+        sys.exit(1)
+    if int(keras.__version__.split(".")[0]) >= 3:
+        print("Error: --qat needs Keras 2 - pip install tf_keras and run with TF_USE_LEGACY_KERAS=1")
+        sys.exit(1)
+
+    qat = tfmot.quantization.keras.quantize_model(model)
+    qat.compile(
+        optimizer=keras.optimizers.Adam(QAT_LR),
+        loss="categorical_crossentropy",
+        metrics=["accuracy"],
+    )
+    print(f"Quantization-aware training, {epochs} epochs")
+    qat.fit(train_ds, validation_data=val_ds, epochs=epochs,
+            callbacks=[keras.callbacks.EarlyStopping(patience=2, restore_best_weights=True)])
+    return qat
+
+
+def compress_model(args, model, images, labels, train_idx, val_idx, calibration, paths):
+    """
+    Prune to --mac-budget / --latency-budget and/or run --qat on a trained
+    model and report the result against it. Returns (model to export, float
+    model to checkpoint).
+    """
+    float_acc = model.evaluate(make_dataset(images, labels, val_idx), verbose=0)[1]
+    baseline = quantize_model(model, calibration)
+    rows = [("float baseline", count_macs(model), model.count_params(), float_acc, None),
+            ("int8 baseline", count_macs(model), model.count_params(),
+             evaluate_tflite(baseline, images, labels, val_idx), len(baseline))]
+
+    budget = int(args.mac_budget) if args.mac_budget else None
+    if args.latency_budget:
+        factor = load_latency_factor(paths)
+        if not factor:
+            print("Error: --latency-budget needs a device calibration - run --device-ms first")
+            sys.exit(1)
+        ms = benchmark_tflite(baseline) * factor
+        budget = int(rows[0][1] * args.latency_budget / ms)
+        print(f"Latency budget {args.latency_budget:.1f} ms vs {ms:.1f} ms now: "
+              f"{budget / 1e6:.2f}M MACs")
+
+    train_ds = make_dataset(images, labels, train_idx, shuffle=True, augment=True)
+    val_ds = make_dataset(images, labels, val_idx)
+    if budget and budget < rows[0][1]:
+        model = prune_to_budget(model, budget, train_ds, val_ds)
+    else:
+        if budget:
+            print("Already within the MAC budget - not pruning")
+        # Same model without the augmentation layers, which QAT can't wrap
+        model = rebuild(model, [np.arange(l.filters) for l in conv_layers(model)])
+    float_model = model
+
+    if args.qat:
+        model = quantization_aware(model, train_ds, val_ds, args.qat_epochs)
+
+    final = quantize_model(model, calibration)
+    parts = (["pruned"] if count_macs(float_model) < rows[0][1] else []) + \
+        (["qat"] if args.qat else [])
+    rows.append((" + ".join(["int8"] + parts), count_macs(float_model),
+                 float_model.count_params(),
+                 evaluate_tflite(final, images, labels, val_idx), len(final)))
+
+    print(f"\n{'Model':<20} {'MACs':>9} {'params':>8} {'accuracy':>9} {'size':>9}")
+    for label, macs, params, acc, size in rows:
+        kb = f"{size / 1024:.1f}KB" if size else ""
+        print(f"{label:<20} {macs / 1e6:>8.2f}M {params:>8} {acc:>9.2%} {kb:>9}")
+    return model, float_model
+
+
 def main():
     parser = argparse.ArgumentParser(description="Train PosturePilot posture classifier")
     parser.add_argument("--data", type=str, default="./data",
-                        help="Path to training data (good/ and bad/ subdirs)")
+                        help="Training data: dir with good/ and bad/ subdirs, a tar from /export, "
+                             "or a packed dataset.json")
     parser.add_argument("--output", type=str, default="../src/model.h",
                         help="Output path for C header")
     parser.add_argument("--epochs", type=int, default=EPOCHS_DEFAULT)
+    parser.add_argument("--input-size", type=int, metavar="PX",
+                        help="Model input (square); default: the previous model's with "
+                             "--incremental, a packed dataset's, else MODEL_INPUT_WIDTH from "
+                             "config.h next to --output. Limits --search to this size")
+    parser.add_argument("--incremental", action="store_true",
+                        help="Fine-tune the previous model on new samples plus a replay subset")
+    parser.add_argument("--finetune-epochs", type=int, default=FINETUNE_EPOCHS)
+    parser.add_argument("--search", action="store_true",
+                        help="Search architectures for the fastest one above --accuracy-floor")
+    parser.add_argument("--search-epochs", type=int, default=SEARCH_EPOCHS)
+    parser.add_argument("--accuracy-floor", type=float, default=0.9,
+                        help="Minimum INT8 validation accuracy for --search")
+    parser.add_argument("--mac-budget", type=float, metavar="MACS",
+                        help="Prune conv filters until the model needs at most this many MACs")
+    parser.add_argument("--latency-budget", type=float, metavar="MS",
+                        help="Prune to an invoke time on the device (needs --device-ms first)")
+    parser.add_argument("--qat", action="store_true",
+                        help="Quantization-aware fine-tune before the INT8 export")
+    parser.add_argument("--qat-epochs", type=int, default=QAT_EPOCHS)
+    parser.add_argument("--device-ms", type=float, metavar="MS",
+                        help="Invoke time the device reports for the current model; "
+                             "calibrates --search latencies and exits")
     args = parser.parse_args()
+    if args.search and args.incremental:
+        parser.error("--search trains from scratch, it can't be --incremental")
+
+    paths = state_paths(args.output)
+    if args.device_ms:
+        calibrate_latency(paths, args.output, args.device_ms)
+        return
+
+    state = load_state(paths) if args.incremental else None
+    if args.incremental and state is None:
+        print("No previous training state next to the output - training from scratch\n")
+
+    # Samples are decoded at the size the model takes, never resized after
+    packed = args.data.endswith(".json")
+    if args.search:
+        sizes = [args.input_size] if args.input_size else SEARCH_INPUTS
+    elif args.input_size or state:
+        sizes = [args.input_size or state[0].input_shape[1]]
+    else:
+        sizes = [None if packed else config_input_size(args.output)]
 
     print(f"PosturePilot Model Training")
     print(f"  Data:   {args.data}")
     print(f"  Output: {args.output}")
-    print(f"  Epochs: {args.epochs}")
-    print(f"  Input:  {IMG_WIDTH}x{IMG_HEIGHT} grayscale")
+    if args.search:
+        print(f"  Search: {len(SEARCH_WIDTHS) * len(SEARCH_SEPARABLE)} architectures at "
+              f"{', '.join(f'{s}x{s}' for s in sizes)}, {args.search_epochs} epochs, "
+              f"floor {args.accuracy_floor:.0%}")
+    else:
+        print(f"  Epochs: {args.finetune_epochs if args.incremental else args.epochs}"
+              f"{' (incremental)' if args.incremental else ''}")
+        print(f"  Input:  {f'{sizes[0]}x{sizes[0]}' if sizes[0] else 'as packed'} grayscale")
     print(f"  Quant:  INT8 (full integer)")
     print()
 
-    train_ds, val_ds, class_names = load_dataset(args.data)
-
-    # Verify class order
-    print(f"Class mapping: {dict(enumerate(class_names))}")
-    if class_names[0] != "bad" or class_names[1] != "good":
-        print("WARNING: Unexpected class order! Firmware assumes bad=0, good=1")
-        print("         Rename your folders so alphabetical order is: bad, good")
-
-    model = build_model()
-    model.summary()
-
-    callbacks = [
-        keras.callbacks.EarlyStopping(patience=5, restore_best_weights=True),
-        keras.callbacks.ReduceLROnPlateau(factor=0.5, patience=3),
-    ]
+    start = time.time()
+    datasets = {}
+    for size in sizes:
+        try:
+            hashes, images, labels = load_dataset(args.data, paths["cache"], size)
+        except ValueError as e:
+            if not args.search:
+                print(f"Error: {e}")
+                sys.exit(1)
+            # PGMs and packed samples exist at one size only
+            print(f"Skipping {size}x{size} candidates: {e}")
+            continue
+        datasets[images.shape[1]] = images
+    if not datasets:
+        print("Error: the samples don't fit any search input size")
+        sys.exit(1)
 
-    history = model.fit(
-        train_ds,
-        validation_data=val_ds,
-        epochs=args.epochs,
-        callbacks=callbacks,
-    )
+    is_val = np.array([is_validation(h) for h in hashes])
+    train_idx = np.flatnonzero(~is_val)
+    val_idx = np.flatnonzero(is_val)
+    if len(train_idx) == 0 or len(val_idx) == 0:
+        print("Error: not enough images for a training and a validation set")
+        sys.exit(1)
+    rng = np.random.RandomState(42)
+
+    if args.search:
+        # The same calibration samples at every size
+        calibration_idx = rng.choice(train_idx, min(CALIBRATION_SAMPLES, len(train_idx)),
+                                     replace=False)
+        model, calibration = search_architectures(
+            args, datasets, labels, train_idx, val_idx, calibration_idx,
+            load_latency_factor(paths))
+        images = datasets[model.input_shape[1]]
+        val_ds = make_dataset(images, labels, val_idx)
+        trained = {hashes[i] for i in train_idx}
+        fit_idx = None
+    elif state:
+        model, trained, previous_calibration = state
+        if model.input_shape[1] != images.shape[1]:
+            print(f"Error: the previous model takes {model.input_shape[1]}x{model.input_shape[1]}, "
+                  f"not {images.shape[1]}x{images.shape[1]} - train from scratch instead")
+            sys.exit(1)
+        val_ds = make_dataset(images, labels, val_idx)
+        new_idx = np.array([i for i in train_idx if hashes[i] not in trained], dtype=int)
+        if len(new_idx) == 0:
+            print("No new training samples since the last run - nothing to do")
+            return
+
+        # Replay some of what the model already learned, so fine-tuning on a
+        # new condition doesn't make it forget the old ones
+        old_idx = np.setdiff1d(train_idx, new_idx)
+        n_replay = min(len(old_idx), max(REPLAY_MIN, REPLAY_RATIO * len(new_idx)))
+        replay_idx = rng.choice(old_idx, n_replay, replace=False)
+        fit_idx = np.concatenate([new_idx, replay_idx])
+        augment = not has_augmentation(model)
+        print(f"Fine-tuning on {len(new_idx)} new + {n_replay} replayed samples")
+
+        model.compile(
+            optimizer=keras.optimizers.Adam(FINETUNE_LR),
+            loss="categorical_crossentropy",
+            metrics=["accuracy"],
+        )
+        epochs = args.finetune_epochs
+        callbacks = [keras.callbacks.EarlyStopping(patience=2, restore_best_weights=True)]
+        calibration = pick_calibration(rng, images, train_idx, previous_calibration, new_idx)
+        trained = trained | {hashes[i] for i in train_idx}
+    else:
+        val_ds = make_dataset(images, labels, val_idx)
+        model = build_model(input_size=images.shape[1])
+        model.summary()
+        fit_idx = train_idx
+        augment = False
+        epochs = args.epochs
+        callbacks = [
+            keras.callbacks.EarlyStopping(patience=5, restore_best_weights=True),
+            keras.callbacks.ReduceLROnPlateau(factor=0.5, patience=3),
+        ]
+        calibration = pick_calibration(rng, images, train_idx)
+        trained = {hashes[i] for i in train_idx}
+
+    if fit_idx is not None:
+        print(f"Training samples: {len(fit_idx)}, validation samples: {len(val_idx)}")
+        model.fit(
+            make_dataset(images, labels, fit_idx, shuffle=True, augment=augment),
+            validation_data=val_ds,
+            epochs=epochs,
+            callbacks=callbacks,
+        )
+
+    checkpoint = model
+    if args.mac_budget or args.latency_budget or args.qat:
+        model, checkpoint = compress_model(args, model, images, labels, train_idx, val_idx,
+                                           calibration, paths)
 
     val_loss, val_acc = model.evaluate(val_ds)
     print(f"\nValidation accuracy: {val_acc:.2%}")
@@ -253,11 +1010,12 @@ def main():
     if val_acc < 0.7:
         print("Warning: accuracy is low. Collect more data or check image quality.")
 
-    # INT8 quantization needs the training data for calibration
-    tflite_model = convert_to_tflite(model, train_ds, args.output)
-    convert_to_header(tflite_model, args.output)
+    tflite_model = convert_to_tflite(model, calibration, args.output)
+    convert_to_header(tflite_model, args.output, model.input_shape[1])
+    # The float model, which --incremental can load without tfmot
+    save_state(paths, checkpoint, trained, calibration, val_acc)
 
-    print(f"\nDone! Flash the firmware to update the model.")
+    print(f"\nDone in {time.time() - start:.0f}s! Flash the firmware to update the model.")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,201 @@
+#include "analytics.h"
+#include "config.h"
+
+#include <string.h>
+
+#define MINUTE_MS 60000ULL
+#define HOUR_MS   3600000ULL
+#define EMPTY_INDEX 0xFFFFFFFFu
+
+// One extra slot each for the window currently being filled
+#define MINUTE_SLOTS (ANALYTICS_MINUTES + 1)
+#define HOUR_SLOTS   (ANALYTICS_HOURS + 1)
+
+static AnalyticsBucket minutes[MINUTE_SLOTS];
+static AnalyticsBucket hours[HOUR_SLOTS];
+
+// 64-bit monotonic clock built from wrapping millis() deltas
+static uint64_t clockMs = 0;
+static uint32_t lastNowMs = 0;
+
+// Held sample (credited until the next one arrives)
+static bool haveSample = false;
+static uint8_t heldLevel = 0;
+static float heldConfidence = 0.0f;
+static bool heldSlouching = false;
+static bool heldValid = false;
+
+// Current slouch episode. A run of slouching frames is a candidate until it
+// lasts ANALYTICS_EPISODE_MIN_MS; a confirmed episode ends once the posture
+// has been good for ANALYTICS_EPISODE_GAP_MS.
+static bool inEpisode = false;
+static uint64_t episodeStartMs = 0;
+static bool slouchRun = false;
+static uint64_t slouchRunStartMs = 0;
+static bool goodRun = false;
+static uint64_t goodRunStartMs = 0;
+
+static void clearBucket(AnalyticsBucket* b, uint32_t index) {
+    memset(b, 0, sizeof(*b));
+    b->index = index;
+}
+
+// Slot for an absolute minute/hour, recycling whatever it held before
+static AnalyticsBucket* bucketFor(AnalyticsBucket* ring, uint32_t slots, uint32_t index) {
+    AnalyticsBucket* b = &ring[index % slots];
+    if (b->index != index) clearBucket(b, index);
+    return b;
+}
+
+static void credit(AnalyticsBucket* b, uint32_t ms) {
+    b->levelMs[heldLevel] += ms;
+    if (heldValid) {
+        int bin = (int)(heldConfidence * ANALYTICS_CONF_BINS);
+        if (bin < 0) bin = 0;
+        if (bin >= ANALYTICS_CONF_BINS) bin = ANALYTICS_CONF_BINS - 1;
+        b->confMs[bin] += ms;
+        b->monitoredMs += ms;
+        if (heldSlouching) b->slouchMs += ms;
+    }
+}
+
+// Move the clock forward by deltaMs, crediting the held sample and
+// splitting across minute boundaries
+static uint8_t advance(uint32_t deltaMs, bool creditHeld) {
+    uint8_t flags = 0;
+
+    while (deltaMs > 0) {
+        uint64_t minuteEnd = (clockMs / MINUTE_MS + 1) * MINUTE_MS;
+        uint32_t chunk = (uint32_t)(minuteEnd - clockMs);
+        if (chunk > deltaMs) chunk = deltaMs;
+
+        if (creditHeld) {
+            credit(bucketFor(minutes, MINUTE_SLOTS, (uint32_t)(clockMs / MINUTE_MS)), chunk);
+            credit(bucketFor(hours, HOUR_SLOTS, (uint32_t)(clockMs / HOUR_MS)), chunk);
+        }
+
+        clockMs += chunk;
+        deltaMs -= chunk;
+
+        if (clockMs % MINUTE_MS == 0) {
+            flags |= ANALYTICS_MINUTE_DONE;
+            if (clockMs % HOUR_MS == 0) flags |= ANALYTICS_HOUR_DONE;
+        }
+    }
+
+    return flags;
+}
+
+void analyticsReset(uint32_t nowMs) {
+    for (int i = 0; i < MINUTE_SLOTS; i++) clearBucket(&minutes[i], EMPTY_INDEX);
+    for (int i = 0; i < HOUR_SLOTS; i++) clearBucket(&hours[i], EMPTY_INDEX);
+    clockMs = 0;
+    lastNowMs = nowMs;
+    haveSample = false;
+    inEpisode = false;
+    slouchRun = false;
+    goodRun = false;
+}
+
+uint8_t analyticsSample(uint32_t nowMs, uint8_t level, float confidence,
+                        bool slouching, bool valid) {
+    uint32_t delta = nowMs - lastNowMs;
+    lastNowMs = nowMs;
+
+    // Long gaps (mode switch, stalled loop) aren't credited to the old sample
+    bool creditHeld = haveSample && delta <= ANALYTICS_MAX_GAP_MS;
+    uint8_t flags = advance(delta, creditHeld);
+
+    if (level >= ANALYTICS_LEVELS) level = ANALYTICS_LEVELS - 1;
+
+    // Episode edges, debounced in both directions
+    bool slouchNow = valid && slouching;
+    if (slouchNow) {
+        goodRun = false;
+        if (!slouchRun) {
+            slouchRun = true;
+            slouchRunStartMs = clockMs;
+        }
+        if (!inEpisode && clockMs - slouchRunStartMs >= ANALYTICS_EPISODE_MIN_MS) {
+            inEpisode = true;
+            episodeStartMs = slouchRunStartMs;
+            bucketFor(minutes, MINUTE_SLOTS, (uint32_t)(clockMs / MINUTE_MS))->episodes++;
+            bucketFor(hours, HOUR_SLOTS, (uint32_t)(clockMs / HOUR_MS))->episodes++;
+        }
+    } else {
+        slouchRun = false;
+        if (inEpisode && !goodRun) {
+            goodRun = true;
+            goodRunStartMs = clockMs;
+        }
+        if (inEpisode && clockMs - goodRunStartMs >= ANALYTICS_EPISODE_GAP_MS) {
+            // The episode ended when the good run started
+            inEpisode = false;
+            goodRun = false;
+            uint64_t len64 = goodRunStartMs - episodeStartMs;
+            uint32_t len = len64 > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)len64;
+            AnalyticsBucket* m = bucketFor(minutes, MINUTE_SLOTS, (uint32_t)(clockMs / MINUTE_MS));
+            AnalyticsBucket* h = bucketFor(hours, HOUR_SLOTS, (uint32_t)(clockMs / HOUR_MS));
+            if (len > m->longestEpisodeMs) m->longestEpisodeMs = len;
+            if (len > h->longestEpisodeMs) h->longestEpisodeMs = len;
+        }
+    }
+
+    haveSample = true;
+    heldLevel = level;
+    heldConfidence = confidence;
+    heldSlouching = slouching;
+    heldValid = valid;
+
+    return flags;
+}
+
+void analyticsPause() {
+    haveSample = false;
+    inEpisode = false;
+    slouchRun = false;
+    goodRun = false;
+}
+
+// Sum ring slots holding indices [current - count, current - 1]
+static AnalyticsSummary summarize(const AnalyticsBucket* ring, uint32_t slots,
+                                  uint32_t current, uint32_t count, uint32_t spanMs) {
+    AnalyticsSummary s;
+    memset(&s, 0, sizeof(s));
+
+    if (count > slots - 1) count = slots - 1;
+    if (count > current) count = current;
+    s.durationMs = count * spanMs;
+
+    for (uint32_t i = 1; i <= count; i++) {
+        uint32_t index = current - i;
+        const AnalyticsBucket* b = &ring[index % slots];
+        if (b->index != index) continue;
+
+        for (int l = 0; l < ANALYTICS_LEVELS; l++) s.levelMs[l] += b->levelMs[l];
+        for (int c = 0; c < ANALYTICS_CONF_BINS; c++) s.confMs[c] += b->confMs[c];
+        s.monitoredMs += b->monitoredMs;
+        s.slouchMs += b->slouchMs;
+        s.episodes += b->episodes;
+        if (b->longestEpisodeMs > s.longestEpisodeMs) s.longestEpisodeMs = b->longestEpisodeMs;
+        s.buckets++;
+    }
+
+    // An episode still in progress isn't in any bucket's longest yet
+    if (inEpisode) {
+        uint64_t end = goodRun ? goodRunStartMs : clockMs;
+        uint64_t len64 = end - episodeStartMs;
+        s.openEpisodeMs = len64 > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)len64;
+        if (s.openEpisodeMs > s.longestEpisodeMs) s.longestEpisodeMs = s.openEpisodeMs;
+    }
+
+    return s;
+}
+
+AnalyticsSummary analyticsLastMinutes(uint32_t count) {
+    return summarize(minutes, MINUTE_SLOTS, (uint32_t)(clockMs / MINUTE_MS), count, MINUTE_MS);
+}
+
+AnalyticsSummary analyticsLastHours(uint32_t count) {
+    return summarize(hours, HOUR_SLOTS, (uint32_t)(clockMs / HOUR_MS), count, HOUR_MS);
+}
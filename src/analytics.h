@@ -0,0 +1,81 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <stdint.h>
+
+// ============================================
+// On-device posture analytics
+// ============================================
+//
+// Time-weighted per-minute and per-hour statistics kept in fixed-size rings
+// (last 60 minutes + last 24 hours, ~7 KB total), so Home Assistant can get
+// one compact summary per minute/hour instead of a raw sample every 5s.
+//
+// Samples are sample-and-hold: the time between two samples is credited to
+// the values of the earlier one. Timestamps are passed in (ms, wrapping
+// uint32 like millis()) so the engine runs against a simulated clock.
+//
+// Slouch episodes are debounced: one only counts after
+// ANALYTICS_EPISODE_MIN_MS of continuous slouching, and only ends after
+// ANALYTICS_EPISODE_GAP_MS without, so single misclassified frames neither
+// start nor split an episode.
+
+#define ANALYTICS_LEVELS     5     // LEVEL_GOOD .. LEVEL_AIRHORN
+#define ANALYTICS_CONF_BINS  10    // Confidence histogram, 0.1 wide bins
+#define ANALYTICS_MINUTES    60    // Minute ring depth
+#define ANALYTICS_HOURS      24    // Hour ring depth
+
+// Returned by analyticsSample() when a window closed during the update
+#define ANALYTICS_MINUTE_DONE 0x01
+#define ANALYTICS_HOUR_DONE   0x02
+
+struct AnalyticsBucket {
+    uint32_t index;                              // Absolute minute/hour number (UINT32_MAX = empty)
+    uint32_t levelMs[ANALYTICS_LEVELS];          // Time spent at each escalation level
+    uint32_t confMs[ANALYTICS_CONF_BINS];        // Time-weighted confidence histogram
+    uint32_t monitoredMs;                        // Time covered by valid inference results
+    uint32_t slouchMs;                           // Time classified as slouching
+    uint32_t longestEpisodeMs;                   // Longest slouch episode that ended here
+    uint16_t episodes;                           // Slouch episodes confirmed here
+};
+
+struct AnalyticsSummary {
+    uint32_t durationMs;                         // Wall time covered by the summary
+    uint32_t levelMs[ANALYTICS_LEVELS];
+    uint32_t confMs[ANALYTICS_CONF_BINS];
+    uint32_t monitoredMs;
+    uint32_t slouchMs;
+    uint32_t longestEpisodeMs;                   // Includes the open episode, if any
+    uint32_t episodes;
+    uint32_t openEpisodeMs;                      // Length so far of the episode in progress (0 = none)
+    uint32_t buckets;                            // Number of buckets with data
+};
+
+// Clear all history and start the clock at nowMs
+void analyticsReset(uint32_t nowMs);
+
+/**
+ * Record one inference result.
+ *
+ * @param nowMs      Current time (millis())
+ * @param level      Escalation level after this frame (0..ANALYTICS_LEVELS-1)
+ * @param confidence Model output, 0 = good, 1 = bad
+ * @param slouching  Classifier decision for this frame
+ * @param valid      False when there's no model / capture failed; the time
+ *                   still counts towards levels but not monitored time/histogram
+ * @return ANALYTICS_*_DONE flags for windows that closed
+ */
+uint8_t analyticsSample(uint32_t nowMs, uint8_t level, float confidence,
+                        bool slouching, bool valid);
+
+// Forget the held sample, e.g. when leaving monitor mode. The gap until the
+// next sample is not credited to anything.
+void analyticsPause();
+
+// Aggregate the last `minutes` completed minutes (1..ANALYTICS_MINUTES)
+AnalyticsSummary analyticsLastMinutes(uint32_t minutes);
+
+// Aggregate the last `hours` completed hours (1..ANALYTICS_HOURS)
+AnalyticsSummary analyticsLastHours(uint32_t hours);
+
+#endif // ANALYTICS_H
@@ -0,0 +1,656 @@
+#include "broadcast.h"
+#include "config.h"
+#include "log.h"
+#include "preprocess.h"
+#include "esp_camera.h"
+#include "lwip/sockets.h"
+
+#define BROADCAST_SLOTS FRAME_HISTORY      // Latest, in-flight and recent frames for /collect
+#define BROADCAST_SLOT_SIZE (96 * 1024)    // Initial capacity, grows for larger frames
+#define BROADCAST_SEND_TIMEOUT_S 5         // Give up on a viewer that stops reading
+#define BROADCAST_PGM_SIZE (PGM_HEADER_MAX + MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT)
+#define ADAPT_PERIOD_MS 1000               // How often quality/size is reconsidered
+#define ADAPT_SETTLE_MS 2000               // After a change, before stepping down again
+#define ADAPT_UPGRADE_MS 5000              // After a change, before stepping back up
+#define PACE_MAX_MS 1000                   // Slowest pacing, 1 fps
+#define HOLD_WAIT_MS 500                   // broadcastHold waiting for level 0
+#define STALE_FRAMES 4                     // Frame buffers (fb_count) captured before a change
+
+static_assert(BROADCAST_SLOTS >= 4, "FRAME_HISTORY must be at least 4");
+
+// MJPEG stream boundary
+#define PART_BOUNDARY "123456789000000000000987654321"
+static const char* STREAM_HEADER =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Cache-Control: no-cache\r\n\r\n";
+static const char* STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
+// Seq lets the page tell /collect exactly which frame is on screen
+static const char* STREAM_PART =
+    "Content-Type: image/jpeg\r\nContent-Length: %u\r\n"
+    "X-Frame-Seq: %u\r\nX-Timestamp: %u\r\n";
+static const char* STREAM_PROGRESS = "X-Burst: %s %d/%d\r\n";
+// What this viewer gets: frame size, quality, latency, fps
+static const char* STREAM_INFO = "X-Stream: %ux%u q%u %ums %ufps\r\n";
+
+// Adaptation steps, cheapest changes first. Step 0 matches the collect
+// camera setup in main.cpp. Frame size only changes with the JPEG sensor
+// mode - with COLLECT_TENSOR the sensor must stay as inference sees it,
+// and quality goes to the software encoder instead.
+struct StreamLevel {
+    uint8_t quality;        // Sensor scale, 4-63, lower is better
+    framesize_t frameSize;
+};
+
+static const StreamLevel LEVELS[] = {
+    {  6, FRAMESIZE_VGA },
+    { 10, FRAMESIZE_VGA },
+    { 16, FRAMESIZE_VGA },
+    { 12, FRAMESIZE_HVGA },
+    { 18, FRAMESIZE_HVGA },
+    { 12, FRAMESIZE_QVGA },
+    { 20, FRAMESIZE_QVGA },
+};
+#define LEVEL_COUNT (int)(sizeof(LEVELS) / sizeof(LEVELS[0]))
+
+struct Client {
+    volatile bool active;       // Sender task running
+    volatile bool closed;       // httpd let go of the session - the sender closes fd
+    httpd_handle_t server;
+    int fd;                     // Owned by the sender task while >= 0
+    TaskHandle_t task;
+    uint32_t ip;
+    uint32_t lastSeq;
+    uint32_t deliveredSeq;      // Last frame fully written to the socket
+    uint32_t delivered;
+    uint32_t dropped;
+    uint32_t bytes;
+    uint32_t connectedAt;
+    uint32_t windowStart;
+    uint32_t windowFrames;
+    float fps;
+    float latencyMs;            // Capture to last byte sent
+    float sendMs;               // Writing one frame to the socket
+    float kbps;
+    uint32_t intervalMs;        // Pacing: earliest next frame after lastSendAt
+    uint32_t lastSendAt;
+};
+
+static FrameSlot slots[BROADCAST_SLOTS];
+static FrameSlot* latest = nullptr;
+static Client clients[BROADCAST_MAX_CLIENTS];
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int holds = 0;                 // Capture users other than viewers
+static const char* progressLabel = nullptr;
+static int progressDone = 0;
+static int progressTotal = 0;
+
+static TaskHandle_t captureTask = nullptr;
+static volatile bool running = false;
+static volatile bool captureDone = true;
+static uint32_t nextSeq = 1;
+
+static uint32_t captured = 0;
+static uint32_t captureDrops = 0;
+static uint32_t captureWindowStart = 0;
+static uint32_t captureWindowFrames = 0;
+static float captureFps = 0;
+
+static volatile int level = 0;
+static uint32_t levelChangedAt = 0;
+static uint32_t adaptedAt = 0;
+// The sensor keeps delivering already-captured buffers after a change, so
+// frames before staleUntilSeq are counted at the previous level
+static int staleLevel = 0;
+static uint32_t staleUntilSeq = 0;
+
+// Frames per second over ~1s windows
+static void countFrame(uint32_t* windowStart, uint32_t* windowFrames, float* fps) {
+    uint32_t now = millis();
+    (*windowFrames)++;
+    uint32_t elapsed = now - *windowStart;
+    if (elapsed >= 1000) {
+        *fps = *windowFrames * 1000.0f / elapsed;
+        *windowStart = now;
+        *windowFrames = 0;
+    }
+}
+
+static bool anyClients() {
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        if (clients[i].active) return true;
+    }
+    return false;
+}
+
+void broadcastHold(bool hold) {
+    portENTER_CRITICAL(&mux);
+    holds += hold ? 1 : -1;
+    portEXIT_CRITICAL(&mux);
+    if (!hold || !captureTask) return;
+
+    // The capture task owns the sensor; it drops to level 0 before its next
+    // frame once it sees the hold
+    xTaskNotifyGive(captureTask);
+    uint32_t start = millis();
+    while (level != 0 && running && millis() - start < HOLD_WAIT_MS) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+
+void broadcastSetProgress(const char* label, int done, int total) {
+    portENTER_CRITICAL(&mux);
+    progressLabel = total > 0 ? label : nullptr;
+    progressDone = done;
+    progressTotal = total;
+    portEXIT_CRITICAL(&mux);
+}
+
+const FrameSlot* broadcastAcquire(uint32_t afterSeq) {
+    FrameSlot* slot = nullptr;
+    portENTER_CRITICAL(&mux);
+    if (latest && latest->seq > afterSeq) {
+        slot = latest;
+        slot->refs++;
+    }
+    portEXIT_CRITICAL(&mux);
+    return slot;
+}
+
+const FrameSlot* broadcastAcquireSeq(uint32_t seq) {
+    FrameSlot* slot = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_SLOTS && seq; i++) {
+        if (slots[i].seq == seq) {
+            slot = &slots[i];
+            slot->refs++;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    return slot;
+}
+
+void broadcastRelease(const FrameSlot* slot) {
+    if (!slot) return;
+    portENTER_CRITICAL(&mux);
+    ((FrameSlot*)slot)->refs--;
+    portEXIT_CRITICAL(&mux);
+}
+
+// The oldest slot nobody is reading (empty slots first), so the others
+// stay available as history
+static FrameSlot* claimSlot() {
+    FrameSlot* slot = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_SLOTS; i++) {
+        FrameSlot* s = &slots[i];
+        if (s == latest || s->refs != 0 || !s->jpg) continue;
+        if (!slot || s->seq < slot->seq) slot = s;
+    }
+    if (slot) slot->seq = 0;
+    portEXIT_CRITICAL(&mux);
+    return slot;
+}
+
+// ============================================
+// Adaptation
+// ============================================
+static void setLevel(int next) {
+    const StreamLevel& l = LEVELS[next];
+    sensor_t* s = esp_camera_sensor_get();
+    if (s && s->pixformat == PIXFORMAT_JPEG) {
+        if (s->status.framesize != l.frameSize) s->set_framesize(s, l.frameSize);
+        s->set_quality(s, l.quality);
+        // Software-encoded frames (COLLECT_TENSOR) switch immediately
+        portENTER_CRITICAL(&mux);
+        staleLevel = level;
+        staleUntilSeq = nextSeq + STALE_FRAMES;
+        portEXIT_CRITICAL(&mux);
+    }
+    LOG_INFO("Stream: level %d -> %d (quality %u)", level, next, l.quality);
+    level = next;
+    levelChangedAt = millis();
+}
+
+// Step quality/size toward keeping the slowest viewer at the target latency.
+// Called from the capture task, which owns the sensor settings.
+static void adapt() {
+    if (holds > 0) {
+        // Burst frames become training samples - take them at full quality,
+        // right away rather than at the next adaptation period
+        if (level != 0) setLevel(0);
+        return;
+    }
+
+    uint32_t now = millis();
+    if (now - adaptedAt < ADAPT_PERIOD_MS) return;
+    adaptedAt = now;
+
+    float worst = -1;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        const Client& c = clients[i];
+        if (c.active && c.delivered >= 3 && c.latencyMs > worst) worst = c.latencyMs;
+    }
+    portEXIT_CRITICAL(&mux);
+    if (worst < 0) return;
+
+    uint32_t since = now - levelChangedAt;
+    if (worst > STREAM_TARGET_LATENCY_MS * 1.25f && level < LEVEL_COUNT - 1 &&
+        since >= ADAPT_SETTLE_MS) {
+        setLevel(level + 1);
+    } else if (worst < STREAM_TARGET_LATENCY_MS * 0.5f && level > 0 &&
+               since >= ADAPT_UPGRADE_MS) {
+        setLevel(level - 1);
+    }
+}
+
+// ============================================
+// Capture task
+// ============================================
+static void captureLoop(void*) {
+    const uint32_t minInterval = 1000 / STREAM_MAX_FPS;
+    uint32_t lastCapture = 0;
+
+    while (running) {
+        if (holds == 0 && !anyClients()) {
+            // Nobody watching - leave the camera alone
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        if (STREAM_ADAPTIVE) adapt();
+
+        uint32_t since = millis() - lastCapture;
+        if (since < minInterval) {
+            vTaskDelay(pdMS_TO_TICKS(minInterval - since));
+        }
+
+        camera_fb_t* fb = esp_camera_fb_get();
+        lastCapture = millis();
+        if (!fb) {
+            LOG_WARN("Stream: capture failed");
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        const uint8_t* jpg = fb->buf;
+        size_t len = fb->len;
+        uint8_t* converted = nullptr;
+        if (fb->format != PIXFORMAT_JPEG) {
+            // Encode once here rather than once per viewer. The encoder's
+            // scale is 0-100, higher is better.
+            if (!frame2jpg(fb, 100 - 2 * LEVELS[level].quality, &converted, &len)) {
+                LOG_WARN("Stream: JPEG convert failed");
+                esp_camera_fb_return(fb);
+                continue;
+            }
+            jpg = converted;
+        }
+
+        FrameSlot* slot = claimSlot();
+        if (slot && len > slot->capacity) {
+            // Only the capture task writes slots, and this one has no readers
+            uint8_t* bigger = (uint8_t*)ps_realloc(slot->jpg, len);
+            if (bigger) {
+                slot->jpg = bigger;
+                slot->capacity = len;
+            } else {
+                slot = nullptr;
+            }
+        }
+
+        if (!slot) {
+            captureDrops++;
+        } else {
+            memcpy(slot->jpg, jpg, len);
+            slot->len = len;
+            slot->timestampMs = lastCapture;
+            slot->width = fb->width;
+            slot->height = fb->height;
+            portENTER_CRITICAL(&mux);
+            int frameLevel = nextSeq < staleUntilSeq ? staleLevel : level;
+            portEXIT_CRITICAL(&mux);
+            slot->level = frameLevel;
+            slot->quality = LEVELS[frameLevel].quality;
+            slot->frameSize = fb->format == PIXFORMAT_JPEG ? LEVELS[frameLevel].frameSize
+                                                           : CAMERA_RESOLUTION;
+            slot->pgmLen = 0;
+            if (fb->format == PIXFORMAT_GRAYSCALE && slot->pgm) {
+                // Exactly what inference would see (COLLECT_TENSOR)
+                size_t h = preprocessPgmHeader(slot->pgm, MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+                preprocessResize(fb->buf, fb->width, fb->height, slot->pgm + h,
+                                 MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+                slot->pgmLen = h + MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT;
+            }
+
+            portENTER_CRITICAL(&mux);
+            slot->seq = nextSeq++;
+            latest = slot;
+            captured++;
+            countFrame(&captureWindowStart, &captureWindowFrames, &captureFps);
+            portEXIT_CRITICAL(&mux);
+
+            for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+                TaskHandle_t t = clients[i].task;
+                if (clients[i].active && t) xTaskNotifyGive(t);
+            }
+        }
+
+        free(converted);
+        esp_camera_fb_return(fb);
+    }
+
+    captureDone = true;
+    vTaskDelete(NULL);
+}
+
+// ============================================
+// Per-viewer sender tasks
+// ============================================
+static bool sendAll(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        int n = lwip_send(fd, p, len, 0);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Exponential moving average, seeded by the first sample
+static void average(float* avg, float sample, bool first) {
+    *avg = first ? sample : *avg + (sample - *avg) * 0.25f;
+}
+
+static void clientLoop(void* arg) {
+    Client* c = (Client*)arg;
+    char part[256];
+
+    while (running && !c->closed) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+        // Paced viewer: wait out the interval before picking a frame, so it
+        // gets the newest one rather than one that queued meanwhile
+        uint32_t since = millis() - c->lastSendAt;
+        if (c->delivered && since < c->intervalMs) {
+            vTaskDelay(pdMS_TO_TICKS(c->intervalMs - since));
+        }
+
+        // Always the newest frame - anything captured meanwhile is skipped
+        const FrameSlot* frame = broadcastAcquire(c->lastSeq);
+        if (!frame) continue;
+
+        uint32_t skipped = c->lastSeq ? frame->seq - c->lastSeq - 1 : 0;
+        c->lastSeq = frame->seq;
+
+        int hlen = snprintf(part, sizeof(part), STREAM_PART, (unsigned)frame->len,
+                            (unsigned)frame->seq, (unsigned)frame->timestampMs);
+        portENTER_CRITICAL(&mux);
+        const char* label = progressLabel;
+        int done = progressDone;
+        int total = progressTotal;
+        unsigned latency = (unsigned)c->latencyMs;
+        unsigned fps = (unsigned)(c->fps + 0.5f);
+        portEXIT_CRITICAL(&mux);
+        if (label) {
+            hlen += snprintf(part + hlen, sizeof(part) - hlen, STREAM_PROGRESS, label, done, total);
+        }
+        hlen += snprintf(part + hlen, sizeof(part) - hlen, STREAM_INFO, frame->width,
+                         frame->height, frame->quality, latency, fps);
+        hlen += snprintf(part + hlen, sizeof(part) - hlen, "\r\n");
+
+        uint32_t start = millis();
+        bool ok = !c->closed &&
+                  sendAll(c->fd, STREAM_BOUNDARY, strlen(STREAM_BOUNDARY)) &&
+                  sendAll(c->fd, part, hlen) &&
+                  sendAll(c->fd, frame->jpg, frame->len);
+        uint32_t end = millis();
+        size_t sent = frame->len;
+        uint32_t seq = frame->seq;
+        uint32_t capturedAt = frame->timestampMs;
+        broadcastRelease(frame);
+        if (!ok) break;
+
+        // A send that blocks means the link, not the socket buffer, is the
+        // limit. Pacing at 80% of that rate keeps queues from building.
+        uint32_t sendMs = end - start;
+        const uint32_t minInterval = 1000 / STREAM_MAX_FPS;
+        portENTER_CRITICAL(&mux);
+        bool first = c->delivered == 0;
+        c->deliveredSeq = seq;
+        c->dropped += skipped;
+        c->delivered++;
+        c->bytes += sent;
+        average(&c->latencyMs, end - capturedAt, first);
+        average(&c->sendMs, sendMs, first);
+        if (sendMs > 0) average(&c->kbps, sent * 8.0f / sendMs, first || c->kbps == 0);
+        c->lastSendAt = start;
+        if (STREAM_ADAPTIVE) {
+            uint32_t paced = (uint32_t)(c->sendMs * 1.25f);
+            if (paced > PACE_MAX_MS) paced = PACE_MAX_MS;
+            c->intervalMs = paced > minInterval ? paced : minInterval;
+        }
+        countFrame(&c->windowStart, &c->windowFrames, &c->fps);
+        portEXIT_CRITICAL(&mux);
+    }
+
+    // If httpd already let go, closing is up to us; otherwise ask it to
+    // drop the session, and broadcastCloseSocket() closes the fd then
+    portENTER_CRITICAL(&mux);
+    int fd = c->fd;
+    bool closeNow = c->closed;
+    c->fd = -1;
+    portEXIT_CRITICAL(&mux);
+    if (closeNow) {
+        lwip_close(fd);
+    } else {
+        httpd_sess_trigger_close(c->server, fd);
+    }
+    c->task = nullptr;
+    c->active = false;
+    vTaskDelete(NULL);
+}
+
+void broadcastCloseSocket(httpd_handle_t, int fd) {
+    TaskHandle_t sender = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        Client& c = clients[i];
+        if (c.fd == fd) {
+            // Still being written to - the sender closes it when it stops,
+            // so the fd number can't be reused by a new connection meanwhile
+            c.closed = true;
+            sender = c.task;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    if (sender) {
+        xTaskNotifyGive(sender);
+    } else {
+        lwip_close(fd);
+    }
+}
+
+static uint32_t peerIp(int fd) {
+    struct sockaddr_in6 addr;
+    socklen_t addrLen = sizeof(addr);
+    if (lwip_getpeername(fd, (struct sockaddr*)&addr, &addrLen) != 0) return 0;
+    // IPv4 peers show up as IPv4-mapped IPv6 addresses
+    return addr.sin6_family == AF_INET ? ((struct sockaddr_in*)&addr)->sin_addr.s_addr
+                                       : addr.sin6_addr.un.u32_addr[3];
+}
+
+uint32_t broadcastDisplayedSeq(httpd_req_t* req) {
+    uint32_t ip = peerIp(httpd_req_to_sockfd(req));
+    uint32_t seq = 0;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS && ip; i++) {
+        const Client& c = clients[i];
+        if (c.active && c.ip == ip && c.deliveredSeq > seq) seq = c.deliveredSeq;
+    }
+    portEXIT_CRITICAL(&mux);
+    return seq;
+}
+
+esp_err_t broadcastStreamHandler(httpd_req_t* req) {
+    Client* c = nullptr;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS && running; i++) {
+        if (!clients[i].active) {
+            c = &clients[i];
+            c->active = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (!c) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Too many stream viewers");
+    }
+
+    int fd = httpd_req_to_sockfd(req);
+    struct timeval timeout = { BROADCAST_SEND_TIMEOUT_S, 0 };
+    lwip_setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    uint32_t ip = peerIp(fd);
+
+    // The response is written by the sender task, not through httpd
+    if (!sendAll(fd, STREAM_HEADER, strlen(STREAM_HEADER))) {
+        c->active = false;
+        return ESP_FAIL;
+    }
+
+    portENTER_CRITICAL(&mux);
+    c->closed = false;
+    c->server = req->handle;
+    c->fd = fd;
+    c->ip = ip;
+    c->lastSeq = 0;
+    c->deliveredSeq = 0;
+    c->delivered = 0;
+    c->dropped = 0;
+    c->bytes = 0;
+    c->connectedAt = millis();
+    c->windowStart = c->connectedAt;
+    c->windowFrames = 0;
+    c->fps = 0;
+    c->latencyMs = 0;
+    c->sendMs = 0;
+    c->kbps = 0;
+    c->intervalMs = 0;
+    c->lastSendAt = 0;
+    portEXIT_CRITICAL(&mux);
+
+    if (xTaskCreatePinnedToCore(clientLoop, "stream", 4096, c, 3, &c->task, tskNO_AFFINITY) != pdPASS) {
+        // httpd closes the session, and with it the fd
+        portENTER_CRITICAL(&mux);
+        c->fd = -1;
+        portEXIT_CRITICAL(&mux);
+        c->active = false;
+        return ESP_FAIL;
+    }
+
+    if (captureTask) xTaskNotifyGive(captureTask);
+    return ESP_OK;
+}
+
+// ============================================
+// Lifecycle
+// ============================================
+bool broadcastSetup() {
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        if (!clients[i].active) clients[i].fd = -1;
+    }
+    for (int i = 0; i < BROADCAST_SLOTS; i++) {
+        if (!slots[i].jpg) {
+            slots[i].jpg = (uint8_t*)ps_malloc(BROADCAST_SLOT_SIZE);
+            slots[i].capacity = slots[i].jpg ? BROADCAST_SLOT_SIZE : 0;
+        }
+        if (COLLECT_FORMAT == COLLECT_TENSOR && !slots[i].pgm) {
+            slots[i].pgm = (uint8_t*)ps_malloc(BROADCAST_PGM_SIZE);
+        }
+        slots[i].len = 0;
+        slots[i].pgmLen = 0;
+        slots[i].seq = 0;
+        slots[i].refs = 0;
+    }
+    latest = nullptr;
+    nextSeq = 1;
+    holds = 0;
+    progressLabel = nullptr;
+    captured = 0;
+    captureDrops = 0;
+    captureFps = 0;
+    captureWindowStart = millis();
+    captureWindowFrames = 0;
+    level = 0;
+    staleUntilSeq = 0;
+    levelChangedAt = millis();
+    adaptedAt = levelChangedAt;
+
+    running = true;
+    captureDone = false;
+    // Core 1 is idle in collect mode (no inference)
+    if (xTaskCreatePinnedToCore(captureLoop, "capture", 6144, NULL, 4, &captureTask, 1) != pdPASS) {
+        running = false;
+        captureDone = true;
+        captureTask = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void broadcastStop() {
+    running = false;
+    if (captureTask) xTaskNotifyGive(captureTask);
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        TaskHandle_t t = clients[i].task;
+        if (clients[i].active && t) xTaskNotifyGive(t);
+    }
+
+    // Senders may be mid-frame (bounded by the send timeout)
+    unsigned long start = millis();
+    while ((!captureDone || anyClients()) && millis() - start < (BROADCAST_SEND_TIMEOUT_S + 1) * 1000) {
+        delay(10);
+    }
+    captureTask = nullptr;
+}
+
+BroadcastStats broadcastGetStats() {
+    BroadcastStats s = {};
+    portENTER_CRITICAL(&mux);
+    s.captureFps = captureFps;
+    s.captured = captured;
+    s.captureDrops = captureDrops;
+    s.level = level;
+    s.quality = LEVELS[level].quality;
+    if (latest) {
+        s.width = latest->width;
+        s.height = latest->height;
+    }
+    for (int i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        const Client& c = clients[i];
+        if (!c.active) continue;
+        BroadcastClientStats& out = s.client[s.clients++];
+        out.active = true;
+        out.ip = c.ip;
+        // No frame for a while (viewer stalled) - don't report a stale rate
+        out.fps = millis() - c.windowStart > 2000 ? 0 : c.fps;
+        out.delivered = c.delivered;
+        out.dropped = c.dropped;
+        out.bytes = c.bytes;
+        out.connectedMs = millis() - c.connectedAt;
+        out.latencyMs = (uint32_t)c.latencyMs;
+        out.kbps = (uint32_t)c.kbps;
+        out.intervalMs = c.intervalMs;
+    }
+    portEXIT_CRITICAL(&mux);
+    return s;
+}
@@ -0,0 +1,106 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include <Arduino.h>
+#include "esp_http_server.h"
+
+// ============================================
+// MJPEG broadcaster (collect mode)
+// ============================================
+//
+// One capture task grabs each camera frame once and publishes it as the
+// latest of a few reference-counted JPEG slots in PSRAM. Every /stream
+// viewer gets its own sender task that writes the current latest slot to
+// its socket straight from the slot (no per-viewer copy or re-encode).
+// A viewer that falls behind skips to the newest frame; capture never
+// waits for it.
+//
+// Slots are reused oldest-first, so the last FRAME_HISTORY frames stay
+// around and /collect can label a frame the user already saw by its seq.
+//
+// With STREAM_ADAPTIVE, each viewer is paced to its measured send rate, and
+// JPEG quality and frame size step down while the slowest viewer's
+// capture-to-sent latency is above STREAM_TARGET_LATENCY_MS.
+
+#define BROADCAST_MAX_CLIENTS 4
+
+struct FrameSlot {
+    uint8_t* jpg;
+    size_t len;
+    size_t capacity;
+    uint8_t* pgm;           // Model input as PGM (grayscale camera only)
+    size_t pgmLen;          // 0 = none
+    uint32_t seq;           // Increments per captured frame, 0 = empty
+    uint32_t timestampMs;
+    uint16_t width;
+    uint16_t height;
+    uint8_t frameSize;      // framesize_t the sensor captured it at
+    uint8_t quality;        // JPEG quality, sensor scale (lower is better)
+    uint8_t level;          // Adaptation step it was captured at, 0 = full quality
+    int refs;               // Readers currently holding the slot
+};
+
+struct BroadcastClientStats {
+    bool active;
+    uint32_t ip;            // IPv4, network order
+    float fps;              // Delivered frames/s over the last second
+    uint32_t delivered;
+    uint32_t dropped;       // Frames skipped because the viewer was behind
+    uint32_t bytes;
+    uint32_t connectedMs;
+    uint32_t latencyMs;     // Capture to last byte sent, averaged
+    uint32_t kbps;          // Measured send throughput
+    uint32_t intervalMs;    // Pacing between frames
+};
+
+struct BroadcastStats {
+    float captureFps;
+    uint32_t captured;
+    uint32_t captureDrops;  // No free slot (every slot held by a reader)
+    int level;              // Adaptation step, 0 = full quality
+    uint8_t quality;
+    uint16_t width;
+    uint16_t height;
+    int clients;
+    BroadcastClientStats client[BROADCAST_MAX_CLIENTS];
+};
+
+// Allocate slots and start the capture task. The camera must be running.
+bool broadcastSetup();
+
+// Stop viewers and the capture task. Call before httpd_stop() and before
+// the camera is deinitialized.
+void broadcastStop();
+
+// /stream handler for the port 81 server. Hands the socket to a sender task
+// and returns immediately, so the server keeps accepting other viewers.
+esp_err_t broadcastStreamHandler(httpd_req_t* req);
+
+// close_fn for the port 81 server. A viewer's socket stays open until its
+// sender task is done with it, even when httpd drops the session.
+void broadcastCloseSocket(httpd_handle_t hd, int fd);
+
+// Take a reference to the newest frame with seq > afterSeq (null if none).
+// Must be released.
+const FrameSlot* broadcastAcquire(uint32_t afterSeq);
+// Reference to the frame with exactly this seq, null once it has been reused.
+const FrameSlot* broadcastAcquireSeq(uint32_t seq);
+void broadcastRelease(const FrameSlot* slot);
+
+// Seq of the newest frame delivered to a stream viewer on the same host as
+// req (0 if that host isn't watching).
+uint32_t broadcastDisplayedSeq(httpd_req_t* req);
+
+// Keep the capture task running without viewers (e.g. during a burst) and
+// the stream at full quality (level 0) meanwhile. Taking a hold waits until
+// the capture task has switched back; frames still queued from before carry
+// their old level. Calls nest; every hold needs a matching release.
+void broadcastHold(bool hold);
+
+// Progress shown to viewers as an X-Burst part header ("bad 12/50").
+// label must be a static string; total 0 clears it.
+void broadcastSetProgress(const char* label, int done, int total);
+
+BroadcastStats broadcastGetStats();
+
+#endif // BROADCAST_H
@@ -0,0 +1,227 @@
+#include "burst.h"
+#include "broadcast.h"
+#include "config.h"
+#include "log.h"
+#include "tar.h"
+#include "freertos/queue.h"
+#include <time.h>
+
+#define BURST_SLOT_SIZE (96 * 1024)     // Initial capacity, grows for larger frames
+#define BURST_FRAME_TIMEOUT_MS 1000     // No new frame for this long - camera is gone
+
+struct BurstBuffer {
+    uint8_t* data;
+    size_t len;
+    size_t capacity;
+};
+
+struct BurstJob {
+    const char* label;
+    DatasetFormat format;
+    int count;
+    uint32_t intervalMs;
+};
+
+static BurstBuffer buffers[BURST_BUFFERS];
+static QueueHandle_t freeQueue = nullptr;   // Empty buffer indexes
+static QueueHandle_t fullQueue = nullptr;   // Captured buffer indexes, in order
+static BurstJob job;
+static BurstFrameHook frameHook = nullptr;
+static volatile bool busy = false;
+static volatile bool abortBurst = false;
+static volatile bool producerDone = true;
+
+bool burstSetup() {
+    if (!freeQueue) freeQueue = xQueueCreate(BURST_BUFFERS, sizeof(int));
+    if (!fullQueue) fullQueue = xQueueCreate(BURST_BUFFERS, sizeof(int));
+    if (!freeQueue || !fullQueue) return false;
+
+    bool ok = true;
+    for (int i = 0; i < BURST_BUFFERS; i++) {
+        if (!buffers[i].data) {
+            buffers[i].data = (uint8_t*)ps_malloc(BURST_SLOT_SIZE);
+            buffers[i].capacity = buffers[i].data ? BURST_SLOT_SIZE : 0;
+        }
+        ok = ok && buffers[i].data;
+    }
+    return ok;
+}
+
+void burstSetFrameHook(BurstFrameHook hook) {
+    frameHook = hook;
+}
+
+// ============================================
+// Capture task
+// ============================================
+static void burstLoop(void*) {
+    uint32_t lastSeq = 0;
+    TickType_t wake = xTaskGetTickCount();
+
+    for (int i = 0; i < job.count && !abortBurst; i++) {
+        if (i > 0) vTaskDelayUntil(&wake, pdMS_TO_TICKS(job.intervalMs));
+
+        // The broadcaster's newest frame, as long as we haven't taken it yet
+        // and it was captured at full quality (frames from before the hold
+        // may still be at a reduced stream level)
+        const FrameSlot* frame = nullptr;
+        uint32_t start = millis();
+        while (!abortBurst) {
+            frame = broadcastAcquire(lastSeq);
+            if (frame && frame->level == 0) break;
+            if (frame) {
+                lastSeq = frame->seq;
+                broadcastRelease(frame);
+                frame = nullptr;
+            }
+            if (millis() - start > BURST_FRAME_TIMEOUT_MS) break;
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        if (!frame) {
+            if (!abortBurst) LOG_WARN("Burst: no frames from camera");
+            break;
+        }
+        lastSeq = frame->seq;
+
+        const uint8_t* data = job.format == DATASET_PGM ? frame->pgm : frame->jpg;
+        size_t len = job.format == DATASET_PGM ? frame->pgmLen : frame->len;
+        if (len == 0) {
+            LOG_WARN("Burst: frame has no PGM (camera not grayscale)");
+            broadcastRelease(frame);
+            break;
+        }
+
+        int idx;
+        if (xQueueReceive(freeQueue, &idx, 0) != pdTRUE) {
+            // The client is BURST_BUFFERS frames behind - wait rather than drop
+            LOG_WARN("Burst: client behind, capture delayed");
+            while (!abortBurst && xQueueReceive(freeQueue, &idx, pdMS_TO_TICKS(100)) != pdTRUE) {}
+            wake = xTaskGetTickCount();
+            if (abortBurst) {
+                broadcastRelease(frame);
+                break;
+            }
+        }
+
+        BurstBuffer& b = buffers[idx];
+        if (len > b.capacity) {
+            uint8_t* bigger = (uint8_t*)ps_realloc(b.data, len);
+            if (!bigger) {
+                LOG_WARN("Burst: frame too large (%u), skipped", (unsigned)len);
+                broadcastRelease(frame);
+                xQueueSend(freeQueue, &idx, 0);
+                continue;
+            }
+            b.data = bigger;
+            b.capacity = len;
+        }
+        memcpy(b.data, data, len);
+        b.len = len;
+        broadcastRelease(frame);
+
+        xQueueSend(fullQueue, &idx, 0);
+        broadcastSetProgress(job.label, i + 1, job.count);
+    }
+
+    producerDone = true;
+    vTaskDelete(NULL);
+}
+
+// ============================================
+// Tar output
+// ============================================
+
+// One tar member: header, data, padding to the block size
+static bool sendEntry(httpd_req_t* req, const char* name, const BurstBuffer& b) {
+    uint8_t header[TAR_BLOCK];
+    tarHeader(header, name, b.len, time(nullptr));
+    size_t pad = tarPadding(b.len);
+    return httpd_resp_send_chunk(req, (const char*)header, TAR_BLOCK) == ESP_OK &&
+           httpd_resp_send_chunk(req, (const char*)b.data, b.len) == ESP_OK &&
+           (pad == 0 || httpd_resp_send_chunk(req, (const char*)TAR_ZERO_BLOCK, pad) == ESP_OK);
+}
+
+int burstRun(httpd_req_t* req, const char* label, DatasetFormat format, int count,
+             uint32_t intervalMs, int firstIndex) {
+    if (busy) {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "burst already running");
+        return -1;
+    }
+
+    xQueueReset(freeQueue);
+    xQueueReset(fullQueue);
+    int available = 0;
+    for (int i = 0; i < BURST_BUFFERS; i++) {
+        if (buffers[i].data && xQueueSend(freeQueue, &i, 0) == pdTRUE) available++;
+    }
+    if (available == 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, "no burst buffers");
+        return -1;
+    }
+
+    busy = true;
+    abortBurst = false;
+    producerDone = false;
+    job.label = label;
+    job.format = format;
+    job.count = count;
+    job.intervalMs = intervalMs;
+
+    broadcastHold(true);
+    broadcastSetProgress(label, 0, count);
+    // Core 1 is idle in collect mode, same as the broadcaster's capture task
+    if (xTaskCreatePinnedToCore(burstLoop, "burst", 4096, NULL, 3, NULL, 1) != pdPASS) {
+        broadcastHold(false);
+        broadcastSetProgress(nullptr, 0, 0);
+        busy = false;
+        httpd_resp_send_500(req);
+        return -1;
+    }
+
+    char disposition[48];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=burst_%s.tar", label);
+    httpd_resp_set_type(req, "application/x-tar");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    int sent = 0;
+    bool ok = true;
+    while (ok) {
+        int idx;
+        if (xQueueReceive(fullQueue, &idx, pdMS_TO_TICKS(100)) != pdTRUE) {
+            // Done flag first: it's set after the last frame is queued
+            if (producerDone && uxQueueMessagesWaiting(fullQueue) == 0) break;
+            continue;
+        }
+
+        const BurstBuffer& b = buffers[idx];
+        uint32_t index = frameHook ? frameHook(label, format, b.data, b.len) : 0;
+        if (index == 0) index = firstIndex + sent;
+
+        char name[48];
+        snprintf(name, sizeof(name), "%s/%s_%u.%s", label, label, (unsigned)index,
+                 datasetExtension(format));
+        ok = sendEntry(req, name, b);
+        xQueueSend(freeQueue, &idx, 0);
+        if (ok) sent++;
+    }
+
+    if (ok) {
+        // End of archive: two empty blocks
+        ok = httpd_resp_send_chunk(req, (const char*)TAR_ZERO_BLOCK, TAR_BLOCK) == ESP_OK &&
+             httpd_resp_send_chunk(req, (const char*)TAR_ZERO_BLOCK, TAR_BLOCK) == ESP_OK &&
+             httpd_resp_send_chunk(req, NULL, 0) == ESP_OK;
+    } else {
+        abortBurst = true;
+        while (!producerDone) delay(10);
+    }
+
+    broadcastHold(false);
+    broadcastSetProgress(nullptr, 0, 0);
+    busy = false;
+
+    LOG_INFO("Burst: %d/%d %s frames sent", sent, count, label);
+    return sent;
+}
@@ -0,0 +1,40 @@
+#ifndef BURST_H
+#define BURST_H
+
+#include <Arduino.h>
+#include "esp_http_server.h"
+#include "dataset.h"
+
+// ============================================
+// Burst capture (collect mode)
+// ============================================
+//
+// /burst?label=bad&count=50&interval_ms=200 takes count frames from the
+// broadcaster on a fixed device-side schedule into preallocated PSRAM
+// buffers, and streams them back as one tar archive while capture goes on
+// (bad/bad_1.jpg or .pgm, ...), ready to extract into the training data dir.
+// A slow client only delays the download, not the capture schedule, unless
+// it falls BURST_BUFFERS frames behind.
+
+#define BURST_MAX_COUNT 500
+
+// Called on the httpd task for every captured frame, before it is sent.
+// A non-zero return (the dataset index) is used as the file number, so
+// the same frame has the same name in /burst and /export archives.
+typedef uint32_t (*BurstFrameHook)(const char* label, DatasetFormat format,
+                                   const uint8_t* data, size_t len);
+
+// Allocate the buffer pool. Call once the camera is running.
+bool burstSetup();
+
+void burstSetFrameHook(BurstFrameHook hook);
+
+// Run one burst on the calling httpd task and send the tar response.
+// label must be a static string ("good"/"bad"); firstIndex numbers the
+// files. DATASET_PGM needs a grayscale camera (COLLECT_TENSOR). Returns the
+// number of frames sent, or -1 if the burst couldn't start (an error
+// response has been sent).
+int burstRun(httpd_req_t* req, const char* label, DatasetFormat format, int count,
+             uint32_t intervalMs, int firstIndex);
+
+#endif // BURST_H
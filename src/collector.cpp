@@ -1,21 +1,21 @@
 #include "collector.h"
 #include "config.h"
+#include "broadcast.h"
+#include "burst.h"
+#include "dataset.h"
+#include "storage.h"
+#include "preprocess.h"
 #include "esp_camera.h"
 #include "esp_http_server.h"
 #include <WiFi.h>
 #include <ArduinoJson.h>
+#include <time.h>
 
 static int collectedGood = 0;
 static int collectedBad = 0;
 static httpd_handle_t stream_httpd = NULL;
 static httpd_handle_t camera_httpd = NULL;
 
-// MJPEG stream boundary
-#define PART_BOUNDARY "123456789000000000000987654321"
-static const char *STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n";
-
 // HTML for data collection web UI
 static const char INDEX_HTML[] PROGMEM = R"rawliteral(
 <!DOCTYPE html>
@@ -36,42 +36,151 @@ static const char INDEX_HTML[] PROGMEM = R"rawliteral(
   .stats { margin: 20px; padding: 15px; background: #16213e; border-radius: 8px; display: inline-block; }
   .stats span { font-size: 1.5em; font-weight: bold; margin: 0 15px; }
   #status { margin: 10px; color: #aaa; }
+  .burst { margin: 10px 0; color: #aaa; }
+  .burst input { width: 60px; padding: 6px; border-radius: 4px; border: none; }
+  .burst button { font-size: 1em; padding: 8px 20px; }
 </style>
 </head>
 <body>
 <h1>PosturePilot Data Collection</h1>
 <img class="stream" id="cam" src="">
+<div id="streaminfo" class="burst"></div>
 <div class="controls">
   <button class="good" onclick="collect('good')">Good Posture (G)</button>
   <button class="bad" onclick="collect('bad')">Bad Posture (B)</button>
 </div>
+<div class="burst">
+  Burst <input id="count" type="number" value="50" min="1" max="500"> frames every
+  <input id="interval" type="number" value="200" min="40" step="10"> ms
+  <button class="good" onclick="burst('good')">Burst Good</button>
+  <button class="bad" onclick="burst('bad')">Burst Bad</button>
+</div>
 <div class="stats">
   Good: <span id="good">0</span> | Bad: <span id="bad">0</span>
 </div>
 <div id="status">Ready. Use buttons or press G/B keys.</div>
+<div id="dataset" class="burst"></div>
 <script>
-// Start MJPEG stream on port 81
+// MJPEG stream on port 81. Parsed here rather than left to <img> so we
+// know the seq of the frame on screen and label exactly that one.
 var cam = document.getElementById('cam');
 var host = window.location.hostname;
-cam.src = 'http://' + host + ':81/stream';
+var streamUrl = 'http://' + host + ':81/stream';
+var shownSeq = 0;
+var decoding = false;
+
+function showFrame(jpg, seq) {
+  if (decoding) return;  // Still drawing the previous frame - skip this one
+  decoding = true;
+  var url = URL.createObjectURL(new Blob([jpg], {type: 'image/jpeg'}));
+  cam.onload = function() { shownSeq = seq; done(); };
+  cam.onerror = done;
+  function done() { URL.revokeObjectURL(url); decoding = false; }
+  cam.src = url;
+}
+
+function headerEnd(buf) {
+  for (var i = 0; i + 3 < buf.length; i++) {
+    if (buf[i] === 13 && buf[i + 1] === 10 && buf[i + 2] === 13 && buf[i + 3] === 10) return i;
+  }
+  return -1;
+}
+
+function startStream() {
+  if (!window.ReadableStream || !window.TextDecoder) { cam.src = streamUrl; return; }
+  fetch(streamUrl).then(resp => {
+    var reader = resp.body.getReader();
+    var dec = new TextDecoder();
+    var buf = new Uint8Array(0);
+    function pump() {
+      return reader.read().then(r => {
+        if (r.done) throw new Error('stream ended');
+        var joined = new Uint8Array(buf.length + r.value.length);
+        joined.set(buf);
+        joined.set(r.value, buf.length);
+        buf = joined;
+        for (;;) {
+          var h = headerEnd(buf);
+          if (h < 0) break;
+          var head = dec.decode(buf.subarray(0, h));
+          var len = /Content-Length: *(\d+)/i.exec(head);
+          if (!len) { buf = buf.subarray(h + 4); continue; }
+          var end = h + 4 + parseInt(len[1]);
+          if (buf.length < end) break;
+          var seq = /X-Frame-Seq: *(\d+)/i.exec(head);
+          var progress = /X-Burst: *([^\r\n]+)/i.exec(head);
+          if (progress) setStatus('Burst ' + progress[1]);
+          // Settings the device picked for this link: WxH, quality, latency, fps
+          var info = /X-Stream: *(\S+) q(\d+) (\d+)ms (\d+)fps/i.exec(head);
+          if (info) {
+            document.getElementById('streaminfo').innerText = 'Stream ' + info[1] +
+              ', quality ' + info[2] + ', ' + info[3] + ' ms latency, ' + info[4] + ' fps';
+          }
+          showFrame(buf.slice(h + 4, end), seq ? parseInt(seq[1]) : 0);
+          buf = buf.subarray(end);
+        }
+        return pump();
+      });
+    }
+    return pump();
+  }).catch(() => { shownSeq = 0; setTimeout(startStream, 1000); });
+}
+startStream();
+
+function setStatus(text) { document.getElementById('status').innerText = text; }
+
+function download(blob, name) {
+  var a = document.createElement('a');
+  a.href = URL.createObjectURL(blob);
+  a.download = name;
+  a.click();
+  URL.revokeObjectURL(a.href);
+}
+
+function refreshCounts() {
+  return fetch('/status').then(r => r.json()).then(d => {
+    goodCount = d.good;
+    badCount = d.bad;
+    document.getElementById('good').innerText = d.good;
+    document.getElementById('bad').innerText = d.bad;
+    if (d.dataset) {
+      document.getElementById('dataset').innerHTML = 'On device (' + d.dataset.storage + '): ' +
+        d.dataset.records + ' images, ' + d.dataset.kbytes + ' KB, ' + d.dataset.free_kbytes +
+        ' KB free &middot; <a href="/export" style="color:#e94560">Export all (.tar)</a>';
+    }
+  });
+}
+
+// Frames are captured on the device and come back as one tar
+// (good/good_N.jpg ...), extract it into the training data dir
+function burst(label) {
+  var count = document.getElementById('count').value;
+  var interval = document.getElementById('interval').value;
+  setStatus('Burst ' + label + ' starting...');
+  fetch('/burst?label=' + label + '&count=' + count + '&interval_ms=' + interval)
+    .then(r => { if (!r.ok) return r.text().then(t => { throw t; }); return r.blob(); })
+    .then(blob => {
+      download(blob, 'burst_' + label + '.tar');
+      return refreshCounts();
+    })
+    .then(() => setStatus('Downloaded burst of ' + label))
+    .catch(e => setStatus('Error: ' + e));
+}
 
 function collect(label) {
-  document.getElementById('status').innerText = 'Capturing ' + label + '...';
-  fetch('/collect?label=' + label)
-    .then(r => r.blob())
+  setStatus('Saving ' + label + '...');
+  fetch('/collect?label=' + label + (shownSeq ? '&seq=' + shownSeq : ''))
+    .then(r => { if (!r.ok) return r.text().then(t => { throw t; }); return r.blob(); })
     .then(blob => {
       // Download the image
-      var count = label === 'good' ? ++goodCount : ++badCount;
-      var a = document.createElement('a');
-      a.href = URL.createObjectURL(blob);
-      a.download = label + '_' + (goodCount + badCount) + '.jpg';
-      a.click();
-      URL.revokeObjectURL(a.href);
+      if (label === 'good') goodCount++;
+      else badCount++;
+      download(blob, label + '_' + (goodCount + badCount) + '.jpg');
       document.getElementById('good').innerText = goodCount;
       document.getElementById('bad').innerText = badCount;
-      document.getElementById('status').innerText = 'Downloaded ' + label + ' (#' + (goodCount + badCount) + ')';
+      setStatus('Downloaded ' + label + ' (#' + (goodCount + badCount) + ')');
     })
-    .catch(e => { document.getElementById('status').innerText = 'Error: ' + e; });
+    .catch(e => setStatus('Error: ' + e));
 }
 var goodCount = 0;
 var badCount = 0;
@@ -79,114 +188,126 @@ document.addEventListener('keydown', function(e) {
   if (e.key === 'g' || e.key === 'G') collect('good');
   if (e.key === 'b' || e.key === 'B') collect('bad');
 });
-fetch('/status').then(r => r.json()).then(d => {
-  document.getElementById('good').innerText = d.good;
-  document.getElementById('bad').innerText = d.bad;
-});
+refreshCounts();
 </script>
 </body>
 </html>
 )rawliteral";
 
 // ============================================
-// MJPEG Stream handler (runs on port 81)
-// Uses esp_http_server for proper chunked streaming
-// Based on Espressif's official CameraWebServer example
+// REST API handlers (run on port 80)
 // ============================================
-static esp_err_t stream_handler(httpd_req_t *req) {
-    camera_fb_t *fb = NULL;
-    esp_err_t res = ESP_OK;
-    size_t _jpg_buf_len = 0;
-    uint8_t *_jpg_buf = NULL;
-    char part_buf[64];
 
-    res = httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
-    if (res != ESP_OK) return res;
+// Serve web UI
+static esp_err_t index_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, INDEX_HTML, strlen(INDEX_HTML));
+}
 
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+// Append a labeled frame to the on-device dataset (no-op unless it was
+// opened in collectorSetup). Returns its index, 0 if not stored.
+// frame is the stream slot the data came from, null for a fresh capture;
+// its frame size and quality win over the sensor's, which the adaptive
+// stream may have changed since.
+static uint32_t store_frame(const char *label, DatasetFormat format, const uint8_t *data, size_t len,
+                            const FrameSlot *frame) {
+    DatasetCamera cam = {};
+    sensor_t *s = esp_camera_sensor_get();
+    if (s) {
+        cam.frameSize = frame ? frame->frameSize : s->status.framesize;
+        cam.quality = frame ? frame->quality : s->status.quality;
+        cam.brightness = s->status.brightness;
+        cam.contrast = s->status.contrast;
+        cam.saturation = s->status.saturation;
+        cam.agcGain = s->status.agc_gain;
+        cam.aecValue = s->status.aec_value;
+    }
+    // Before NTP sync the clock counts from 1970
+    time_t now = time(nullptr);
+    uint32_t unixTime = now > 1700000000 ? (uint32_t)now : 0;
+    return datasetAppend(label[0] == 'g' ? DATASET_GOOD : DATASET_BAD, format, unixTime, millis(),
+                         cam, data, len);
+}
 
-    while (true) {
-        fb = esp_camera_fb_get();
-        if (!fb) {
-            Serial.println("Stream: capture failed");
-            res = ESP_FAIL;
-            break;
-        }
+// Burst frames are all taken at stream level 0, which is what the sensor
+// is set to while the burst holds the broadcaster
+static uint32_t store_burst_frame(const char *label, DatasetFormat format, const uint8_t *data,
+                                  size_t len) {
+    return store_frame(label, format, data, len, NULL);
+}
 
-        if (fb->format != PIXFORMAT_JPEG) {
-            bool ok = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
-            esp_camera_fb_return(fb);
-            fb = NULL;
-            if (!ok) {
-                Serial.println("Stream: JPEG convert failed");
-                res = ESP_FAIL;
-                break;
-            }
+// ?format=jpeg|pgm, default from COLLECT_FORMAT. pgm is the 96x96 model
+// input and needs the grayscale camera (COLLECT_TENSOR).
+static bool parse_format(httpd_req_t *req, const char *query, DatasetFormat *format) {
+    char value[8];
+    *format = COLLECT_FORMAT == COLLECT_TENSOR ? DATASET_PGM : DATASET_JPEG;
+    if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+        if (strcmp(value, "pgm") == 0) {
+            *format = DATASET_PGM;
+        } else if (strcmp(value, "jpeg") == 0 || strcmp(value, "jpg") == 0) {
+            *format = DATASET_JPEG;
         } else {
-            _jpg_buf_len = fb->len;
-            _jpg_buf = fb->buf;
-        }
-
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, STREAM_BOUNDARY, strlen(STREAM_BOUNDARY));
-        }
-        if (res == ESP_OK) {
-            size_t hlen = snprintf(part_buf, 64, STREAM_PART, _jpg_buf_len);
-            res = httpd_resp_send_chunk(req, part_buf, hlen);
-        }
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
-        }
-
-        if (fb) {
-            esp_camera_fb_return(fb);
-            fb = NULL;
-            _jpg_buf = NULL;
-        } else if (_jpg_buf) {
-            free(_jpg_buf);
-            _jpg_buf = NULL;
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "format must be jpeg or pgm");
+            return false;
         }
-
-        if (res != ESP_OK) break;
-
-        delay(30);  // ~30fps cap
     }
-
-    return res;
+    if (*format == DATASET_PGM && COLLECT_FORMAT != COLLECT_TENSOR) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "pgm needs COLLECT_FORMAT COLLECT_TENSOR");
+        return false;
+    }
+    return true;
 }
 
-// ============================================
-// REST API handlers (run on port 80)
-// ============================================
-
-// Serve web UI
-static esp_err_t index_handler(httpd_req_t *req) {
-    httpd_resp_set_type(req, "text/html");
-    return httpd_resp_send(req, INDEX_HTML, strlen(INDEX_HTML));
+// Store (if labeled) and send a frame, with X-Dataset-Index when stored
+static esp_err_t send_frame(httpd_req_t *req, const char *label, DatasetFormat format,
+                            const uint8_t *data, size_t len, const FrameSlot *frame = NULL) {
+    char indexHdr[12];
+    uint32_t index = label ? store_frame(label, format, data, len, frame) : 0;
+    if (index) {
+        snprintf(indexHdr, sizeof(indexHdr), "%u", (unsigned)index);
+        httpd_resp_set_hdr(req, "X-Dataset-Index", indexHdr);
+    }
+    httpd_resp_set_type(req, format == DATASET_PGM ? "image/x-portable-graymap" : "image/jpeg");
+    return httpd_resp_send(req, (const char *)data, len);
 }
 
-// Capture single JPEG
-static esp_err_t capture_handler(httpd_req_t *req) {
+// Send a freshly captured frame, stored in the dataset if labeled
+static esp_err_t send_capture(httpd_req_t *req, const char *label, DatasetFormat format) {
     camera_fb_t *fb = esp_camera_fb_get();
     if (!fb) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
 
-    httpd_resp_set_type(req, "image/jpeg");
-    httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-
     esp_err_t res;
+    if (format == DATASET_PGM) {
+        // Same resize as inference
+        const int pixels = MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT;
+        uint8_t *pgm = (uint8_t *)malloc(PGM_HEADER_MAX + pixels);
+        if (!pgm || fb->format != PIXFORMAT_GRAYSCALE) {
+            free(pgm);
+            esp_camera_fb_return(fb);
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        size_t h = preprocessPgmHeader(pgm, MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+        preprocessResize(fb->buf, fb->width, fb->height, pgm + h,
+                         MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+        esp_camera_fb_return(fb);
+        res = send_frame(req, label, format, pgm, h + pixels);
+        free(pgm);
+        return res;
+    }
+
     if (fb->format == PIXFORMAT_JPEG) {
-        res = httpd_resp_send(req, (const char *)fb->buf, fb->len);
+        res = send_frame(req, label, format, fb->buf, fb->len);
     } else {
         uint8_t *jpg_buf = NULL;
         size_t jpg_len = 0;
         bool ok = frame2jpg(fb, 90, &jpg_buf, &jpg_len);
         esp_camera_fb_return(fb);
         if (ok) {
-            res = httpd_resp_send(req, (const char *)jpg_buf, jpg_len);
+            res = send_frame(req, label, format, jpg_buf, jpg_len);
             free(jpg_buf);
         } else {
             httpd_resp_send_500(req);
@@ -199,9 +320,20 @@ static esp_err_t capture_handler(httpd_req_t *req) {
     return res;
 }
 
-// Collect labeled image
+// Capture single JPEG
+static esp_err_t capture_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "image/jpeg");
+    httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return send_capture(req, NULL, DATASET_JPEG);
+}
+
+// Collect labeled image.
+// ?seq= picks a frame from the stream history (the page sends the one on
+// screen). Without it, the frame last delivered to this host's stream is
+// used, and only if this host isn't watching is a new frame captured.
 static esp_err_t collect_handler(httpd_req_t *req) {
-    char buf[32];
+    char buf[64];
     if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing query");
         return ESP_FAIL;
@@ -218,10 +350,31 @@ static esp_err_t collect_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    DatasetFormat format;
+    if (!parse_format(req, buf, &format)) return ESP_FAIL;
+
+    char seqStr[12];
+    uint32_t seq;
+    if (httpd_query_key_value(buf, "seq", seqStr, sizeof(seqStr)) == ESP_OK) {
+        seq = strtoul(seqStr, NULL, 10);
+    } else {
+        seq = broadcastDisplayedSeq(req);
+    }
+
+    const FrameSlot *frame = NULL;
+    if (seq) {
+        frame = broadcastAcquireSeq(seq);
+        if (!frame) {
+            // Better to fail than to label a frame the user never saw
+            httpd_resp_set_status(req, "410 Gone");
+            httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+            return httpd_resp_sendstr(req, "frame no longer in history");
+        }
+        if (format == DATASET_PGM && frame->pgmLen == 0) {
+            broadcastRelease(frame);
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
     }
 
     if (strcmp(label, "good") == 0) collectedGood++;
@@ -230,42 +383,125 @@ static esp_err_t collect_handler(httpd_req_t *req) {
 
     // Build filename for download
     char filename[64];
-    snprintf(filename, sizeof(filename), "attachment; filename=%s_%d.jpg", label, total);
+    snprintf(filename, sizeof(filename), "attachment; filename=%s_%d.%s", label, total,
+             datasetExtension(format));
 
-    httpd_resp_set_type(req, "image/jpeg");
     httpd_resp_set_hdr(req, "Content-Disposition", filename);
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
 
     esp_err_t res;
-    if (fb->format == PIXFORMAT_JPEG) {
-        res = httpd_resp_send(req, (const char *)fb->buf, fb->len);
-    } else {
-        uint8_t *jpg_buf = NULL;
-        size_t jpg_len = 0;
-        bool ok = frame2jpg(fb, 90, &jpg_buf, &jpg_len);
-        esp_camera_fb_return(fb);
-        if (ok) {
-            res = httpd_resp_send(req, (const char *)jpg_buf, jpg_len);
-            free(jpg_buf);
+    if (frame) {
+        char seqHdr[12], ageHdr[12];
+        snprintf(seqHdr, sizeof(seqHdr), "%u", (unsigned)frame->seq);
+        snprintf(ageHdr, sizeof(ageHdr), "%u", (unsigned)(millis() - frame->timestampMs));
+        httpd_resp_set_hdr(req, "X-Frame-Seq", seqHdr);
+        httpd_resp_set_hdr(req, "X-Frame-Age-Ms", ageHdr);
+        if (format == DATASET_PGM) {
+            res = send_frame(req, label, format, frame->pgm, frame->pgmLen, frame);
         } else {
-            httpd_resp_send_500(req);
-            return ESP_FAIL;
+            res = send_frame(req, label, format, frame->jpg, frame->len, frame);
         }
-        return res;
+        broadcastRelease(frame);
+    } else {
+        res = send_capture(req, label, format);
     }
 
-    esp_camera_fb_return(fb);
-
     #if DEBUG_MODE
-    Serial.printf("Collected: %s #%d\n", label, total);
+    Serial.printf("Collected: %s #%d (seq %u)\n", label, total, (unsigned)seq);
     #endif
 
     return res;
 }
 
+// Labeled burst: ?label=bad&count=50&interval_ms=200[&format=pgm], returns
+// a tar. Blocks this server until done - progress goes out on the stream.
+static esp_err_t burst_handler(httpd_req_t *req) {
+    char buf[96];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing query");
+        return ESP_FAIL;
+    }
+
+    char param[12];
+    if (httpd_query_key_value(buf, "label", param, sizeof(param)) != ESP_OK ||
+        (strcmp(param, "good") != 0 && strcmp(param, "bad") != 0)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "label must be good or bad");
+        return ESP_FAIL;
+    }
+    // Static copy - the burst task and logger keep the pointer
+    const char *label = strcmp(param, "good") == 0 ? "good" : "bad";
+
+    int count = 20;
+    if (httpd_query_key_value(buf, "count", param, sizeof(param)) == ESP_OK) count = atoi(param);
+    uint32_t interval = 200;
+    if (httpd_query_key_value(buf, "interval_ms", param, sizeof(param)) == ESP_OK) interval = atoi(param);
+
+    if (count < 1 || count > BURST_MAX_COUNT) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "count out of range");
+        return ESP_FAIL;
+    }
+    // Faster than the stream capture rate would just repeat frames
+    if (interval < 1000 / STREAM_MAX_FPS || interval > 60000) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "interval_ms out of range");
+        return ESP_FAIL;
+    }
+
+    DatasetFormat format;
+    if (!parse_format(req, buf, &format)) return ESP_FAIL;
+
+    int sent = burstRun(req, label, format, count, interval, collectedGood + collectedBad + 1);
+    if (sent < 0) return ESP_OK;
+
+    if (label[0] == 'g') collectedGood += sent;
+    else collectedBad += sent;
+    return ESP_OK;
+}
+
+static bool send_chunk(void *ctx, const void *data, size_t len) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, len) == ESP_OK;
+}
+
+// Whole on-device dataset as one tar, streamed straight from storage.
+// Blocks this server until done.
+static esp_err_t export_handler(httpd_req_t *req) {
+    httpd_resp_set_type(req, "application/x-tar");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=dataset.tar");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+    unsigned long start = millis();
+    if (!datasetExport(send_chunk, req)) {
+        // Headers are gone already - dropping the connection marks it incomplete
+        Serial.println("Dataset export aborted");
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    Serial.printf("Dataset exported in %lu ms\n", millis() - start);
+    return ESP_OK;
+}
+
+// Delete the on-device dataset: /clear?confirm=yes
+static esp_err_t clear_handler(httpd_req_t *req) {
+    char buf[32];
+    char confirm[8];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) != ESP_OK ||
+        httpd_query_key_value(buf, "confirm", confirm, sizeof(confirm)) != ESP_OK ||
+        strcmp(confirm, "yes") != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "add ?confirm=yes");
+        return ESP_FAIL;
+    }
+    if (!datasetClear()) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    collectedGood = 0;
+    collectedBad = 0;
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    return httpd_resp_sendstr(req, "cleared");
+}
+
 // Device status
 static esp_err_t status_handler(httpd_req_t *req) {
-    StaticJsonDocument<256> doc;
+    StaticJsonDocument<2048> doc;
     doc["mode"] = "collect";
     doc["good"] = collectedGood;
     doc["bad"] = collectedBad;
@@ -274,7 +510,42 @@ static esp_err_t status_handler(httpd_req_t *req) {
     doc["free_psram"] = ESP.getFreePsram();
     doc["ip"] = WiFi.localIP().toString();
 
-    char buf[256];
+    if (DATASET_ENABLE) {
+        DatasetStats ds = datasetStats();
+        JsonObject dataset = doc.createNestedObject("dataset");
+        dataset["storage"] = storageName();
+        dataset["records"] = ds.records;
+        dataset["kbytes"] = ds.bytes / 1024;
+        dataset["free_kbytes"] = (uint32_t)(storageFreeBytes() / 1024);
+    }
+
+    // Stream: one capture, fanned out to every viewer
+    BroadcastStats bs = broadcastGetStats();
+    JsonObject stream = doc.createNestedObject("stream");
+    stream["capture_fps"] = serialized(String(bs.captureFps, 1));
+    stream["captured"] = bs.captured;
+    stream["capture_drops"] = bs.captureDrops;
+    stream["level"] = bs.level;
+    stream["quality"] = bs.quality;
+    stream["width"] = bs.width;
+    stream["height"] = bs.height;
+    stream["target_latency_ms"] = STREAM_TARGET_LATENCY_MS;
+    JsonArray viewers = stream.createNestedArray("clients");
+    for (int i = 0; i < bs.clients; i++) {
+        const BroadcastClientStats& c = bs.client[i];
+        JsonObject v = viewers.createNestedObject();
+        v["ip"] = IPAddress(c.ip).toString();
+        v["fps"] = serialized(String(c.fps, 1));
+        v["delivered"] = c.delivered;
+        v["dropped"] = c.dropped;
+        v["kbytes"] = c.bytes / 1024;
+        v["connected_s"] = c.connectedMs / 1000;
+        v["latency_ms"] = c.latencyMs;
+        v["kbps"] = c.kbps;
+        v["interval_ms"] = c.intervalMs;
+    }
+
+    char buf[2048];
     serializeJson(doc, buf);
 
     httpd_resp_set_type(req, "application/json");
@@ -283,29 +554,58 @@ static esp_err_t status_handler(httpd_req_t *req) {
 }
 
 void collectorSetup() {
+    if (!broadcastSetup()) {
+        Serial.println("Stream broadcaster failed to start");
+    }
+    if (!burstSetup()) {
+        Serial.println("Burst buffers not available");
+    }
+    burstSetFrameHook(store_burst_frame);
+
+    // Counts carry over from what's already stored
+    if (DATASET_ENABLE && datasetBegin()) {
+        DatasetStats ds = datasetStats();
+        collectedGood = ds.good;
+        collectedBad = ds.bad;
+    }
+
     // Start camera HTTP server on port 80 (web UI + API)
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
     config.max_uri_handlers = 8;
+    config.stack_size = 8192;   // /status JSON and burst/export buffers
 
     httpd_uri_t index_uri = { .uri = "/", .method = HTTP_GET, .handler = index_handler };
     httpd_uri_t capture_uri = { .uri = "/capture", .method = HTTP_GET, .handler = capture_handler };
     httpd_uri_t collect_uri = { .uri = "/collect", .method = HTTP_GET, .handler = collect_handler };
+    httpd_uri_t burst_uri = { .uri = "/burst", .method = HTTP_GET, .handler = burst_handler };
+    httpd_uri_t export_uri = { .uri = "/export", .method = HTTP_GET, .handler = export_handler };
+    httpd_uri_t clear_uri = { .uri = "/clear", .method = HTTP_GET, .handler = clear_handler };
     httpd_uri_t status_uri = { .uri = "/status", .method = HTTP_GET, .handler = status_handler };
 
     if (httpd_start(&camera_httpd, &config) == ESP_OK) {
         httpd_register_uri_handler(camera_httpd, &index_uri);
         httpd_register_uri_handler(camera_httpd, &capture_uri);
         httpd_register_uri_handler(camera_httpd, &collect_uri);
+        httpd_register_uri_handler(camera_httpd, &burst_uri);
+        httpd_register_uri_handler(camera_httpd, &export_uri);
+        httpd_register_uri_handler(camera_httpd, &clear_uri);
         httpd_register_uri_handler(camera_httpd, &status_uri);
         Serial.printf("Web UI: http://%s/\n", WiFi.localIP().toString().c_str());
     }
 
-    // Start MJPEG stream server on port 81 (separate so it doesn't block API)
+    // Start MJPEG stream server on port 81 (separate so it doesn't block API).
+    // The handler only hands each viewer's socket to a broadcaster task, so
+    // one server task serves any number of viewers.
     config.server_port = 81;
     config.ctrl_port = 32769;
+    // No LRU purge: it would close a viewer's socket to make room, and the
+    // sender task writes to it without going through httpd
+    config.lru_purge_enable = false;
+    config.max_open_sockets = BROADCAST_MAX_CLIENTS + 1;    // + one to turn away
+    config.close_fn = broadcastCloseSocket;
 
-    httpd_uri_t stream_uri = { .uri = "/stream", .method = HTTP_GET, .handler = stream_handler };
+    httpd_uri_t stream_uri = { .uri = "/stream", .method = HTTP_GET, .handler = broadcastStreamHandler };
 
     if (httpd_start(&stream_httpd, &config) == ESP_OK) {
         httpd_register_uri_handler(stream_httpd, &stream_uri);
@@ -313,6 +613,24 @@ void collectorSetup() {
     }
 }
 
+void collectorStop() {
+    // Viewers and the capture task first - they use the sockets and camera
+    broadcastStop();
+
+    // httpd_stop() waits for the server task to finish its current handler
+    if (stream_httpd) {
+        httpd_stop(stream_httpd);
+        stream_httpd = NULL;
+    }
+    if (camera_httpd) {
+        httpd_stop(camera_httpd);
+        camera_httpd = NULL;
+    }
+    datasetEnd();
+
+    Serial.println("Collector servers stopped");
+}
+
 void collectorLoop() {
     // Both servers handle requests via ESP-IDF httpd tasks, nothing to do here
 }
@@ -4,10 +4,15 @@
 #include <Arduino.h>
 
 // Start the data collection HTTP servers:
-//   Port 80: Web UI + REST API (/capture, /collect, /status)
+//   Port 80: Web UI + REST API (/capture, /collect, /burst, /export,
+//            /clear, /status)
 //   Port 81: MJPEG live stream (/stream)
 void collectorSetup();
 
+// Stop both servers (ends any open /stream connections first).
+// Must be called before the camera is deinitialized.
+void collectorStop();
+
 // Called in loop (not needed — servers run in background tasks)
 void collectorLoop();
 
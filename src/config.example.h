@@ -14,7 +14,14 @@
 #define MQTT_PORT 1883
 #define MQTT_USER ""                  // Leave empty if no auth
 #define MQTT_PASS ""
-#define MQTT_CLIENT_ID "posture-pilot"
+#define MQTT_CLIENT_ID "posture-pilot"   // MAC suffix is appended
+
+// MQTT over TLS (see examples/mosquitto-tls/ for a self-signed test broker)
+#define MQTT_USE_TLS false
+#define MQTT_TLS_PORT 8883
+#define MQTT_TLS_HANDSHAKE_TIMEOUT_MS 3000   // Hard cap on TCP connect + handshake
+// CA that signed the broker certificate (PEM). Empty = no verification (testing only!)
+#define MQTT_CA_CERT ""
 
 // MQTT Topics
 #define TOPIC_STATUS "posture-pilot/status"
@@ -45,6 +52,16 @@ enum DeviceMode { MODE_COLLECT, MODE_MONITOR };
 // ============================================
 #define SLOUCH_THRESHOLD 0.5f        // Confidence above this = slouching
 
+// ============================================
+// Analytics
+// ============================================
+// Per-minute/hour summaries are published to posture-pilot/analytics.
+// With raw state off, the 5s samples stop; level changes are still published.
+#define PUBLISH_RAW_STATE true
+#define ANALYTICS_MAX_GAP_MS 5000    // Longer gaps between frames aren't credited
+#define ANALYTICS_EPISODE_MIN_MS 5000  // Slouching this long before it counts as an episode
+#define ANALYTICS_EPISODE_GAP_MS 3000  // Good posture this long before an episode ends
+
 // ============================================
 // Escalation Timers (seconds)
 // ============================================
@@ -64,7 +81,40 @@ enum DeviceMode { MODE_COLLECT, MODE_MONITOR };
 // ============================================
 #define COLLECT_IMAGE_WIDTH  320
 #define COLLECT_IMAGE_HEIGHT 240
+// COLLECT_JPEG   = 640x480 color JPEG samples
+// COLLECT_TENSOR = camera set up as in monitor mode (grayscale, CAMERA_RESOLUTION)
+//                  and samples are the exact 96x96 model input as PGM (~9 KB).
+//                  The stream is still JPEG; /collect?format=jpeg still works.
+enum CollectFormat { COLLECT_JPEG, COLLECT_TENSOR };
+#define COLLECT_FORMAT COLLECT_JPEG
 #define WEB_SERVER_PORT 80
+#define STREAM_MAX_FPS 25            // Capture rate cap for /stream (shared by all viewers)
+#define FRAME_HISTORY 16             // Recent stream frames kept in PSRAM for /collect?seq= (min 4)
+#define STREAM_ADAPTIVE true         // Pace viewers and lower JPEG quality/size on slow links
+#define STREAM_TARGET_LATENCY_MS 250 // Capture to sent, for the slowest viewer
+#define BURST_BUFFERS 8              // PSRAM frame buffers between /burst capture and download
+
+// ============================================
+// Dataset Store (collect mode)
+// ============================================
+// Labeled frames (/collect, /burst) are also appended to a log on the
+// device and kept across reboots. GET /export downloads them all as a tar.
+#define DATASET_ENABLE true
+#define DATASET_STORAGE STORAGE_LITTLEFS  // STORAGE_LITTLEFS (~1.5 MB, ~50 frames) or STORAGE_SD
+#define SD_CS_PIN 21                      // Sense board microSD (shared with the user LED)
+#define DATASET_MIN_FREE (64 * 1024)      // Stop appending below this much free space
+#define NTP_SERVER "pool.ntp.org"         // Wall-clock timestamps for records ("" = uptime only)
+
+// ============================================
+// Power Management
+// ============================================
+// POWER_PERFORMANCE = full clock, radio always on
+// POWER_BALANCED    = 80 MHz between frames, 240 MHz for inference, modem sleep
+// POWER_ECO         = 80/160 MHz, max modem sleep, automatic light sleep
+//                     (SDK permitting, and only while the camera is stopped)
+// Can be changed at runtime via MQTT: posture-pilot/power/set
+#define POWER_POLICY POWER_BALANCED
+#define POWER_MAX_IDLE_MS 100        // Longest single idle sleep (keeps MQTT/OTA responsive)
 
 // ============================================
 // OTA Settings
@@ -72,10 +122,49 @@ enum DeviceMode { MODE_COLLECT, MODE_MONITOR };
 #define OTA_HOSTNAME "posture-pilot"
 // #define OTA_PASSWORD "changeme"
 
+// Pull OTA (scripts/pack_ota.py + scripts/ota_server.py). Triggered by
+// publishing a manifest URL to posture-pilot/ota/update; an empty payload
+// uses this default.
+#define OTA_MANIFEST_URL "http://192.168.1.100:8070/manifest.json"
+// Public half of the ECDSA P-256 key pack_ota.py --key signs manifests
+// with (PEM, "-----BEGIN PUBLIC KEY-----\n...\n-----END PUBLIC KEY-----\n").
+// Set, only signed manifests are flashed, from any host. Empty, unsigned
+// manifests are accepted, but only from OTA_MANIFEST_URL's host.
+#define OTA_PUBLIC_KEY ""
+#define OTA_BLOCK_RETRIES 5          // Per-block attempts before giving up (progress is kept)
+
+// ============================================
+// Frame Trace Recording
+// ============================================
+// Streams monitor-mode frames + model output to scripts/record_trace.py,
+// for replay in the host simulator (pio run -e native)
+#define TRACE_RECORD false
+#define TRACE_HOST "192.168.1.10"        // Machine running record_trace.py
+#define TRACE_PORT 8072
+#define TRACE_DOWNSAMPLE 2               // 1 = full QVGA (~380 KB/s at 5 fps), 2 = 160x120
+
+// ============================================
+// Debug View (monitor mode)
+// ============================================
+// WebSocket on DEBUG_VIEW_PORT pushing the 96x96 model input, confidence,
+// level and stage timings; open http://<ip>:82/ in a browser. Costs nothing
+// while no one is connected.
+#define DEBUG_VIEW false
+#define DEBUG_VIEW_PORT 82
+#define DEBUG_VIEW_EVERY 5               // Send every Nth frame (?every= overrides)
+
 // ============================================
 // Debug
 // ============================================
 #define DEBUG_MODE true
+
+// Deferred logger (see log.h). Levels below LOG_LEVEL are compiled out.
+// LOG_LEVEL_DEBUG / LOG_LEVEL_INFO / LOG_LEVEL_WARN / LOG_LEVEL_ERROR / LOG_LEVEL_NONE
+#define LOG_LEVEL (DEBUG_MODE ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO)
+// LOG_OUTPUT_TEXT = formatted on device, LOG_OUTPUT_BINARY = raw records
+// (decode with scripts/decode_log.py --elf firmware.elf)
+#define LOG_OUTPUT LOG_OUTPUT_TEXT
+#define LOG_MQTT false               // Also publish binary records to posture-pilot/log
 // #define STREAM_ENABLED false  // Removed: streaming now built into collector
 
 #endif // CONFIG_H
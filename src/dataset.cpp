@@ -0,0 +1,339 @@
+#include "dataset.h"
+#include "storage.h"
+#include "tar.h"
+#include "config.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DATASET_MAX_LEN (1024 * 1024)    // Sanity bound when parsing
+#define EXPORT_CHUNK 4096
+
+static const char* CSV_HEADER =
+    "file,label,format,index,unix_time,uptime_ms,frame_size,quality,"
+    "brightness,contrast,saturation,agc_gain,aec_value,crc32\n";
+
+static bool ready = false;
+static DatasetStats stats;
+static uint32_t nextIndex = 1;
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// CRC-32 (IEEE), same as zlib.crc32 / binascii.crc32. Start with crc = 0;
+// feeding the data in pieces gives the same result as one call.
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// Check a record's data against its CRC, reading through buf (EXPORT_CHUNK)
+static bool dataIntact(StorageFile* f, uint32_t pos, const DatasetRecord& r, uint8_t* buf) {
+    if (!storageSeek(f, pos + DATASET_RECORD_HEADER_SIZE)) return false;
+    uint32_t crc = 0;
+    uint32_t len = r.len;
+    while (len > 0) {
+        size_t n = len < EXPORT_CHUNK ? len : EXPORT_CHUNK;
+        if (storageRead(f, buf, n) != n) return false;
+        crc = crc32(crc, buf, n);
+        len -= n;
+    }
+    return crc == r.crc;
+}
+
+size_t datasetEncodeRecordHeader(const DatasetRecord& r, uint8_t* out) {
+    memcpy(out, "PPDR", 4);
+    out[4] = DATASET_VERSION;
+    out[5] = r.label;
+    out[6] = r.camera.frameSize;
+    out[7] = r.camera.quality;
+    put32(out + 8, r.index);
+    put32(out + 12, r.unixTime);
+    put32(out + 16, r.uptimeMs);
+    out[20] = (uint8_t)r.camera.brightness;
+    out[21] = (uint8_t)r.camera.contrast;
+    out[22] = (uint8_t)r.camera.saturation;
+    out[23] = r.camera.agcGain;
+    put16(out + 24, r.camera.aecValue);
+    out[26] = r.format;
+    out[27] = 0;
+    put32(out + 28, r.len);
+    put32(out + 32, r.crc);
+    return DATASET_RECORD_HEADER_SIZE;
+}
+
+bool datasetDecodeRecordHeader(const uint8_t* in, DatasetRecord* r) {
+    if (memcmp(in, "PPDR", 4) != 0 || in[4] != DATASET_VERSION) return false;
+
+    r->label = in[5];
+    r->camera.frameSize = in[6];
+    r->camera.quality = in[7];
+    r->index = get32(in + 8);
+    r->unixTime = get32(in + 12);
+    r->uptimeMs = get32(in + 16);
+    r->camera.brightness = (int8_t)in[20];
+    r->camera.contrast = (int8_t)in[21];
+    r->camera.saturation = (int8_t)in[22];
+    r->camera.agcGain = in[23];
+    r->camera.aecValue = get16(in + 24);
+    r->format = in[26];
+    r->len = get32(in + 28);
+    r->crc = get32(in + 32);
+    return r->label <= DATASET_GOOD && r->format <= DATASET_PGM &&
+           r->len > 0 && r->len <= DATASET_MAX_LEN;
+}
+
+// Find the next complete record at or after *pos. Anything that doesn't
+// parse is skipped by scanning for the next magic. With verifyBuf
+// (EXPORT_CHUNK bytes), records whose data fails the CRC are counted in
+// *corrupt and skipped the same way.
+static bool nextRecord(StorageFile* f, uint32_t size, uint32_t* pos, DatasetRecord* r,
+                       uint32_t* skipped, uint8_t* verifyBuf = nullptr,
+                       uint32_t* corrupt = nullptr) {
+    uint8_t buf[256];
+    while (*pos + DATASET_RECORD_HEADER_SIZE <= size) {
+        storageSeek(f, *pos);
+        if (storageRead(f, buf, DATASET_RECORD_HEADER_SIZE) == DATASET_RECORD_HEADER_SIZE &&
+            datasetDecodeRecordHeader(buf, r) &&
+            *pos + DATASET_RECORD_HEADER_SIZE + r->len <= size) {
+            if (!verifyBuf || dataIntact(f, *pos, *r, verifyBuf)) return true;
+            LOG_WARN("Dataset: record %u at %u fails its CRC, skipped",
+                     (unsigned)r->index, (unsigned)*pos);
+            (*corrupt)++;
+        }
+
+        uint32_t from = *pos + 1;
+        uint32_t found = size;
+        while (found == size && from + 4 <= size) {
+            storageSeek(f, from);
+            size_t n = storageRead(f, buf, sizeof(buf));
+            if (n < 4) break;
+            for (size_t i = 0; i + 4 <= n; i++) {
+                if (memcmp(buf + i, "PPDR", 4) == 0) {
+                    found = from + i;
+                    break;
+                }
+            }
+            from += n - 3;
+        }
+        *skipped += found - *pos;
+        *pos = found;
+    }
+    return false;
+}
+
+static const char* labelName(uint8_t label) {
+    return label == DATASET_GOOD ? "good" : "bad";
+}
+
+const char* datasetExtension(uint8_t format) {
+    return format == DATASET_PGM ? "pgm" : "jpg";
+}
+
+// Same layout as /burst archives, so both extract into one data dir
+static void recordName(char* out, size_t cap, const DatasetRecord& r) {
+    snprintf(out, cap, "%s/%s_%u.%s", labelName(r.label), labelName(r.label), (unsigned)r.index,
+             datasetExtension(r.format));
+}
+
+static int csvLine(char* out, size_t cap, const DatasetRecord& r) {
+    char name[48];
+    recordName(name, sizeof(name), r);
+    return snprintf(out, cap, "%s,%s,%s,%u,%u,%u,%u,%u,%d,%d,%d,%u,%u,%08x\n",
+                    name, labelName(r.label), datasetExtension(r.format),
+                    (unsigned)r.index, (unsigned)r.unixTime,
+                    (unsigned)r.uptimeMs, r.camera.frameSize, r.camera.quality,
+                    r.camera.brightness, r.camera.contrast, r.camera.saturation,
+                    r.camera.agcGain, r.camera.aecValue, (unsigned)r.crc);
+}
+
+bool datasetBegin() {
+    if (!storageBegin()) {
+        LOG_WARN("Dataset: %s storage unavailable", storageName());
+        return false;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    nextIndex = 1;
+
+    StorageFile* f = storageOpen(DATASET_PATH, "r");
+    if (f) {
+        uint32_t size = storageSize(f);
+        uint32_t pos = 0;
+        DatasetRecord r;
+        while (nextRecord(f, size, &pos, &r, &stats.skippedBytes)) {
+            stats.records++;
+            if (r.label == DATASET_GOOD) stats.good++;
+            else stats.bad++;
+            if (r.index >= nextIndex) nextIndex = r.index + 1;
+            pos += DATASET_RECORD_HEADER_SIZE + r.len;
+        }
+        stats.bytes = size;
+        storageClose(f);
+    }
+
+    if (stats.skippedBytes) {
+        LOG_WARN("Dataset: skipped %u unreadable bytes", (unsigned)stats.skippedBytes);
+    }
+    LOG_INFO("Dataset: %u records (%u good, %u bad) on %s",
+             (unsigned)stats.records, (unsigned)stats.good, (unsigned)stats.bad, storageName());
+    ready = true;
+    return true;
+}
+
+void datasetEnd() {
+    if (!ready) return;
+    storageEnd();
+    ready = false;
+}
+
+uint32_t datasetAppend(DatasetLabel label, DatasetFormat format, uint32_t unixTime,
+                       uint32_t uptimeMs, const DatasetCamera& camera,
+                       const uint8_t* data, size_t len) {
+    if (!ready || len == 0 || len > DATASET_MAX_LEN) return 0;
+    if (storageFreeBytes() < len + DATASET_RECORD_HEADER_SIZE + DATASET_MIN_FREE) {
+        LOG_WARN("Dataset: storage full");
+        return 0;
+    }
+
+    DatasetRecord r = {};
+    r.label = label;
+    r.index = nextIndex;
+    r.unixTime = unixTime;
+    r.uptimeMs = uptimeMs;
+    r.camera = camera;
+    r.format = format;
+    r.len = len;
+    r.crc = crc32(0, data, len);
+
+    uint8_t header[DATASET_RECORD_HEADER_SIZE];
+    datasetEncodeRecordHeader(r, header);
+
+    // Header and data in one open/close, so the record is committed whole
+    StorageFile* f = storageOpen(DATASET_PATH, "a");
+    if (!f) {
+        LOG_WARN("Dataset: can't open log");
+        return 0;
+    }
+    bool ok = storageWrite(f, header, sizeof(header)) == sizeof(header) &&
+              storageWrite(f, data, len) == len;
+    storageClose(f);
+    if (!ok) {
+        LOG_WARN("Dataset: write failed");
+        return 0;
+    }
+
+    stats.records++;
+    if (label == DATASET_GOOD) stats.good++;
+    else stats.bad++;
+    stats.bytes += sizeof(header) + len;
+    return nextIndex++;
+}
+
+DatasetStats datasetStats() {
+    return stats;
+}
+
+bool datasetClear() {
+    if (!ready || !storageRemove(DATASET_PATH)) return false;
+    memset(&stats, 0, sizeof(stats));
+    nextIndex = 1;
+    LOG_INFO("Dataset: cleared");
+    return true;
+}
+
+static bool copyData(StorageFile* f, uint32_t pos, uint32_t len, uint8_t* buf,
+                     DatasetSink sink, void* ctx) {
+    if (!storageSeek(f, pos)) return false;
+    while (len > 0) {
+        size_t n = len < EXPORT_CHUNK ? len : EXPORT_CHUNK;
+        if (storageRead(f, buf, n) != n || !sink(ctx, buf, n)) return false;
+        len -= n;
+    }
+    return true;
+}
+
+bool datasetExport(DatasetSink sink, void* ctx) {
+    uint8_t* buf = (uint8_t*)malloc(EXPORT_CHUNK);
+    if (!buf) return false;
+
+    StorageFile* f = ready ? storageOpen(DATASET_PATH, "r") : nullptr;
+    uint32_t size = f ? storageSize(f) : 0;
+    uint32_t csvLen = strlen(CSV_HEADER);
+    uint32_t latest = 0;
+    uint32_t skipped = 0;
+    uint32_t corrupt = 0;
+    char line[160];
+    bool ok = true;
+
+    // Images. The tar header goes out before the data, so each record is
+    // checked against its CRC first and a corrupt one is left out entirely.
+    uint32_t pos = 0;
+    DatasetRecord r;
+    while (ok && f && nextRecord(f, size, &pos, &r, &skipped, buf, &corrupt)) {
+        char name[48];
+        recordName(name, sizeof(name), r);
+        tarHeader(buf, name, r.len, r.unixTime);
+        size_t pad = tarPadding(r.len);
+        ok = sink(ctx, buf, TAR_BLOCK) &&
+             copyData(f, pos + DATASET_RECORD_HEADER_SIZE, r.len, buf, sink, ctx) &&
+             (pad == 0 || sink(ctx, TAR_ZERO_BLOCK, pad));
+
+        csvLen += csvLine(line, sizeof(line), r);
+        if (r.unixTime > latest) latest = r.unixTime;
+        pos += DATASET_RECORD_HEADER_SIZE + r.len;
+    }
+
+    // metadata.csv - its size is known now, a second pass over the headers
+    // writes the lines. It only has to re-check CRCs if the first pass
+    // dropped something, to drop the same records here.
+    if (ok) {
+        tarHeader(buf, "metadata.csv", csvLen, latest);
+        ok = sink(ctx, buf, TAR_BLOCK) && sink(ctx, CSV_HEADER, strlen(CSV_HEADER));
+        pos = 0;
+        uint32_t recheck = 0;
+        while (ok && f && nextRecord(f, size, &pos, &r, &skipped,
+                                     corrupt ? buf : nullptr, &recheck)) {
+            int n = csvLine(line, sizeof(line), r);
+            ok = sink(ctx, line, n);
+            pos += DATASET_RECORD_HEADER_SIZE + r.len;
+        }
+        size_t pad = tarPadding(csvLen);
+        ok = ok && (pad == 0 || sink(ctx, TAR_ZERO_BLOCK, pad)) &&
+             sink(ctx, TAR_ZERO_BLOCK, TAR_BLOCK) && sink(ctx, TAR_ZERO_BLOCK, TAR_BLOCK);
+    }
+
+    if (corrupt) {
+        LOG_WARN("Dataset: %u corrupt records left out of the export", (unsigned)corrupt);
+    }
+    stats.corrupt = corrupt;
+
+    storageClose(f);
+    free(buf);
+    return ok;
+}
@@ -0,0 +1,94 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Dataset store
+// ============================================
+//
+// Labeled frames appended to one log file (storage.h), so collection
+// survives reboots and can run unattended. Little endian, one record per
+// frame, no file header:
+//
+//   "PPDR" | version u8 | label u8 | frame_size u8 | quality u8 |
+//   index u32 | unix_time u32 | uptime_ms u32 |
+//   brightness i8 | contrast i8 | saturation i8 | agc_gain u8 |
+//   aec_value u16 | format u8 | reserved u8 | len u32 | crc32 u32 | data
+//
+// data is a JPEG, or a PGM of the preprocessed model input (COLLECT_TENSOR).
+//
+// A record is written whole and then the file is closed, which is when
+// LittleFS and FAT commit the new size, so a power cut loses at most the
+// record being written. Anything that still doesn't parse is skipped by
+// scanning for the next magic.
+
+#define DATASET_VERSION 1
+#define DATASET_RECORD_HEADER_SIZE 36
+#define DATASET_PATH "/dataset.ppds"
+
+// Class order used by the model (alphabetical): bad = 0, good = 1
+enum DatasetLabel : uint8_t { DATASET_BAD = 0, DATASET_GOOD = 1 };
+
+enum DatasetFormat : uint8_t { DATASET_JPEG = 0, DATASET_PGM = 1 };
+
+// Camera settings at capture time (framesize_t, sensor status fields)
+struct DatasetCamera {
+    uint8_t frameSize;
+    uint8_t quality;
+    int8_t brightness;
+    int8_t contrast;
+    int8_t saturation;
+    uint8_t agcGain;
+    uint16_t aecValue;
+};
+
+struct DatasetRecord {
+    uint8_t label;
+    uint32_t index;             // 1-based, increasing
+    uint32_t unixTime;          // 0 if the clock wasn't set
+    uint32_t uptimeMs;
+    DatasetCamera camera;
+    uint8_t format;             // DatasetFormat
+    uint32_t len;
+    uint32_t crc;               // CRC-32 of the data
+};
+
+struct DatasetStats {
+    uint32_t records;
+    uint32_t good;
+    uint32_t bad;
+    uint32_t bytes;             // Log size
+    uint32_t skippedBytes;      // Unparseable data passed over by the scan
+    uint32_t corrupt;           // Records the last export left out for a bad CRC
+};
+
+size_t datasetEncodeRecordHeader(const DatasetRecord& r, uint8_t* out);
+bool datasetDecodeRecordHeader(const uint8_t* in, DatasetRecord* r);
+
+// Open storage and scan the log for counts. False if storage is unavailable.
+bool datasetBegin();
+void datasetEnd();
+
+// Append a frame. Returns its index, or 0 on failure (storage full, write error).
+uint32_t datasetAppend(DatasetLabel label, DatasetFormat format, uint32_t unixTime,
+                       uint32_t uptimeMs, const DatasetCamera& camera,
+                       const uint8_t* data, size_t len);
+
+// File extension for a format ("jpg", "pgm")
+const char* datasetExtension(uint8_t format);
+
+DatasetStats datasetStats();
+
+// Delete every record
+bool datasetClear();
+
+// Stream the whole dataset as a tar: good/good_<index>.jpg (or .pgm), bad/..., and
+// metadata.csv with the per-record fields. Reads the log in small chunks,
+// nothing is buffered. Records whose data fails the CRC are left out of
+// both and counted in DatasetStats::corrupt. Stops early if sink returns false.
+typedef bool (*DatasetSink)(void* ctx, const void* data, size_t len);
+bool datasetExport(DatasetSink sink, void* ctx);
+
+#endif // DATASET_H
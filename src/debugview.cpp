@@ -0,0 +1,291 @@
+#include "debugview.h"
+#include "config.h"
+#include "log.h"
+#include "preprocess.h"
+
+#include <Arduino.h>
+#include "sdkconfig.h"
+#include "esp_http_server.h"
+#include "lwip/sockets.h"
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#define MESSAGE_SIZE (DEBUG_VIEW_HEADER_SIZE + MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT)
+#define EVERY_MAX 1000
+
+static const char VIEW_HTML[] PROGMEM = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+<meta name="viewport" content="width=device-width, initial-scale=1">
+<title>PosturePilot Debug View</title>
+<style>
+  body { font-family: sans-serif; text-align: center; background: #1a1a2e; color: #eee; margin: 0; padding: 20px; }
+  h1 { color: #e94560; }
+  canvas { width: 384px; height: 384px; image-rendering: pixelated; border-radius: 8px; transform: scaleX(-1); }
+  #info { margin: 15px; font-family: monospace; white-space: pre; color: #aaa; }
+</style>
+</head>
+<body>
+<h1>Model input</h1>
+<canvas id="view" width="96" height="96"></canvas>
+<div id="info">Connecting...</div>
+<script>
+var canvas = document.getElementById('view');
+var ctx = canvas.getContext('2d');
+var info = document.getElementById('info');
+var every = new URLSearchParams(location.search).get('every') || '';
+
+function connect() {
+  var ws = new WebSocket('ws://' + location.host + '/ws' + (every ? '?every=' + every : ''));
+  ws.binaryType = 'arraybuffer';
+  ws.onmessage = function(e) {
+    // Layout in debugview.h
+    var d = new DataView(e.data);
+    var w = d.getUint16(4, true), h = d.getUint16(6, true);
+    if (canvas.width !== w || canvas.height !== h) { canvas.width = w; canvas.height = h; }
+    var px = new Uint8Array(e.data, 32, w * h);
+    var img = ctx.createImageData(w, h);
+    for (var i = 0; i < w * h; i++) {
+      img.data[i * 4] = img.data[i * 4 + 1] = img.data[i * 4 + 2] = px[i];
+      img.data[i * 4 + 3] = 255;
+    }
+    ctx.putImageData(img, 0, 0);
+    var model = d.getUint8(3);
+    info.innerText =
+      'frame ' + d.getUint32(8, true) + '  level ' + d.getUint8(1) +
+      (d.getUint8(2) ? '  SLOUCHING' : '  good') + '\n' +
+      (model ? 'confidence ' + d.getFloat32(16, true).toFixed(3) : 'no model') + '\n' +
+      'capture ' + (d.getUint32(20, true) / 1000).toFixed(1) + ' ms  preprocess ' +
+      (d.getUint32(24, true) / 1000).toFixed(1) + ' ms  invoke ' +
+      (d.getUint32(28, true) / 1000).toFixed(1) + ' ms';
+  };
+  ws.onclose = function() { info.innerText = 'Disconnected, retrying...'; setTimeout(connect, 2000); };
+}
+connect();
+</script>
+</body>
+</html>
+)rawliteral";
+
+struct Subscriber {
+    int fd;                 // -1 = free
+    int every;              // Send every Nth frame
+    int counter;
+    bool due;               // Wants the message being sent
+};
+
+static httpd_handle_t server = NULL;
+static Subscriber subscribers[DEBUG_VIEW_MAX_CLIENTS];
+static volatile int subscriberCount = 0;
+static volatile bool sending = false;
+static uint8_t* message = nullptr;
+static uint32_t frameCount = 0;
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static void removeSubscriber(int fd) {
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < DEBUG_VIEW_MAX_CLIENTS; i++) {
+        if (subscribers[i].fd == fd) {
+            subscribers[i].fd = -1;
+            subscriberCount--;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+// ============================================
+// httpd side
+// ============================================
+
+// Runs on the httpd task, so a slow viewer blocks the server, not the frame loop
+static void sendWork(void*) {
+    httpd_ws_frame_t pkt = {};
+    pkt.type = HTTPD_WS_TYPE_BINARY;
+    pkt.final = true;
+    pkt.payload = message;
+    pkt.len = MESSAGE_SIZE;
+
+    for (int i = 0; i < DEBUG_VIEW_MAX_CLIENTS; i++) {
+        portENTER_CRITICAL(&mux);
+        int fd = subscribers[i].due ? subscribers[i].fd : -1;
+        subscribers[i].due = false;
+        portEXIT_CRITICAL(&mux);
+        if (fd < 0) continue;
+
+        if (httpd_ws_get_fd_info(server, fd) != HTTPD_WS_CLIENT_WEBSOCKET ||
+            httpd_ws_send_frame_async(server, fd, &pkt) != ESP_OK) {
+            removeSubscriber(fd);
+            httpd_sess_trigger_close(server, fd);
+        }
+    }
+    sending = false;
+}
+
+static esp_err_t index_handler(httpd_req_t* req) {
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, VIEW_HTML, strlen(VIEW_HTML));
+}
+
+static esp_err_t ws_handler(httpd_req_t* req) {
+    if (req->method == HTTP_GET) {
+        // Handshake done - register the subscriber
+        int every = DEBUG_VIEW_EVERY;
+        char query[32], value[8];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "every", value, sizeof(value)) == ESP_OK) {
+            every = atoi(value);
+            if (every < 1) every = 1;
+            if (every > EVERY_MAX) every = EVERY_MAX;
+        }
+
+        int fd = httpd_req_to_sockfd(req);
+        bool added = false;
+        portENTER_CRITICAL(&mux);
+        for (int i = 0; i < DEBUG_VIEW_MAX_CLIENTS && !added; i++) {
+            if (subscribers[i].fd < 0) {
+                subscribers[i] = { fd, every, 0, false };
+                subscriberCount++;
+                added = true;
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+        if (!added) return ESP_FAIL;
+
+        LOG_INFO("Debug view: viewer connected, every %d frames", every);
+        return ESP_OK;
+    }
+
+    // The view is one-way - read and drop whatever the browser sends
+    httpd_ws_frame_t pkt = {};
+    uint8_t buf[32];
+    if (httpd_ws_recv_frame(req, &pkt, 0) != ESP_OK || pkt.len > sizeof(buf)) return ESP_FAIL;
+    pkt.payload = buf;
+    return pkt.len ? httpd_ws_recv_frame(req, &pkt, pkt.len) : ESP_OK;
+}
+
+// httpd leaves closing to us once close_fn is set
+static void onClose(httpd_handle_t, int fd) {
+    removeSubscriber(fd);
+    close(fd);
+}
+
+bool debugViewStart() {
+    if (server) return true;
+    if (!message) message = (uint8_t*)ps_malloc(MESSAGE_SIZE);
+    if (!message) return false;
+
+    for (int i = 0; i < DEBUG_VIEW_MAX_CLIENTS; i++) subscribers[i].fd = -1;
+    subscriberCount = 0;
+    sending = false;
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = DEBUG_VIEW_PORT;
+    config.ctrl_port = 32770;
+    config.max_open_sockets = DEBUG_VIEW_MAX_CLIENTS + 1;    // + the page load
+    config.lru_purge_enable = true;
+    config.send_wait_timeout = 2;
+    config.close_fn = onClose;
+    // Same priority as the loop task rather than httpd's default above it,
+    // so a send never preempts inference
+    config.task_priority = tskIDLE_PRIORITY + 1;
+
+    if (httpd_start(&server, &config) != ESP_OK) {
+        server = NULL;
+        return false;
+    }
+
+    httpd_uri_t index_uri = { .uri = "/", .method = HTTP_GET, .handler = index_handler };
+    httpd_uri_t ws_uri = { .uri = "/ws", .method = HTTP_GET, .handler = ws_handler,
+                           .user_ctx = NULL, .is_websocket = true };
+    httpd_register_uri_handler(server, &index_uri);
+    httpd_register_uri_handler(server, &ws_uri);
+
+    LOG_INFO("Debug view on port %d", DEBUG_VIEW_PORT);
+    return true;
+}
+
+void debugViewStop() {
+    if (!server) return;
+    // Waits for a queued send to finish
+    httpd_stop(server);
+    server = NULL;
+    subscriberCount = 0;
+    sending = false;
+}
+
+// ============================================
+// Frame loop side
+// ============================================
+void debugViewFrame(const HalFrame& frame, const InferenceResult* result,
+                    const PostureState& state) {
+    frameCount++;
+    // The whole cost while nobody watches, or while the last one is still going out
+    if (subscriberCount == 0 || sending || !server) return;
+
+    bool any = false;
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < DEBUG_VIEW_MAX_CLIENTS; i++) {
+        Subscriber& s = subscribers[i];
+        if (s.fd >= 0 && ++s.counter >= s.every) {
+            s.counter = 0;
+            s.due = true;
+            any = true;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+    if (!any) return;
+
+    uint8_t* p = message;
+    p[0] = DEBUG_VIEW_VERSION;
+    p[1] = state.currentLevel;
+    p[2] = state.isSlouching;
+    p[3] = result != nullptr;
+    put16(p + 4, MODEL_INPUT_WIDTH);
+    put16(p + 6, MODEL_INPUT_HEIGHT);
+    put32(p + 8, frameCount);
+    put32(p + 12, millis());
+    float confidence = result ? result->confidence : 0.0f;
+    memcpy(p + 16, &confidence, 4);
+    put32(p + 20, result ? result->captureUs : 0);
+    put32(p + 24, result ? result->preprocessUs : 0);
+    put32(p + 28, result ? result->invokeUs : 0);
+
+    // The tensor inference just used; without a model, the same resize
+    const uint8_t* input = result ? inferenceInputPixels() : nullptr;
+    if (input) {
+        memcpy(p + DEBUG_VIEW_HEADER_SIZE, input, MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT);
+    } else {
+        preprocessResize(frame.buf, frame.width, frame.height, p + DEBUG_VIEW_HEADER_SIZE,
+                         MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+    }
+
+    sending = true;
+    if (httpd_queue_work(server, sendWork, NULL) != ESP_OK) sending = false;
+}
+
+#else
+
+// esp_http_server built without WebSocket support (CONFIG_HTTPD_WS_SUPPORT)
+bool debugViewStart() {
+    LOG_WARN("Debug view: no WebSocket support in this build");
+    return false;
+}
+
+void debugViewStop() {}
+
+void debugViewFrame(const HalFrame&, const InferenceResult*, const PostureState&) {}
+
+#endif // CONFIG_HTTPD_WS_SUPPORT
@@ -0,0 +1,42 @@
+#ifndef DEBUGVIEW_H
+#define DEBUGVIEW_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "inference.h"
+#include "monitor.h"
+
+// ============================================
+// Debug view (monitor mode)
+// ============================================
+//
+// Optional WebSocket on DEBUG_VIEW_PORT that shows what the model sees,
+// without switching to collect mode and its different camera profile.
+// Every Nth frame goes out as the raw 96x96 model input plus confidence,
+// level and per-stage timings - no JPEG encode. Nothing is copied while
+// nobody is connected, and while the previous message is still being
+// sent, frames are skipped rather than queued, so the frame loop never
+// waits on a viewer.
+//
+// ws://<ip>:82/ws?every=5, one binary message per frame, little endian:
+//
+//   version u8 | level u8 | slouching u8 | model_loaded u8 |
+//   width u16 | height u16 | frame u32 | timestamp_ms u32 | confidence f32 |
+//   capture_us u32 | preprocess_us u32 | invoke_us u32 | pixels (width*height)
+//
+// http://<ip>:82/ serves a page that draws it.
+
+#define DEBUG_VIEW_VERSION 1
+#define DEBUG_VIEW_HEADER_SIZE 32
+#define DEBUG_VIEW_MAX_CLIENTS 2
+
+// Start the server (monitor mode, WiFi up). False if it can't run.
+bool debugViewStart();
+void debugViewStop();
+
+// Called after every processed frame, before the frame is returned.
+// result is null when running without a model.
+void debugViewFrame(const HalFrame& frame, const InferenceResult* result,
+                    const PostureState& state);
+
+#endif // DEBUGVIEW_H
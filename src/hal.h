@@ -0,0 +1,39 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Hardware abstraction for the monitor path
+// ============================================
+//
+// Everything processFrame() -> updateEscalationLevel() -> publishState()
+// touches outside plain C++: clock, camera, LED and MQTT.
+//
+//   hal_esp32.cpp  - the real thing (millis, esp_camera, GPIO, PubSubClient)
+//   sim/sim_hal.cpp - virtual clock, frames from a trace file, mock/real broker
+
+struct HalFrame {
+    const uint8_t* buf;     // 8-bit grayscale, width * height
+    size_t len;
+    int width;
+    int height;
+    void* handle;           // Backend-specific (camera_fb_t* on the device)
+};
+
+uint32_t halMillis();
+uint32_t halMicros();        // Stage timings
+void halDelay(uint32_t ms);
+
+// Grab a grayscale frame. Every successful grab must be returned.
+bool halCameraGrab(HalFrame* frame);
+void halCameraReturn(HalFrame* frame);
+
+void halLed(bool on);
+
+bool halMqttConnected();
+bool halPublish(const char* topic, const char* payload, bool retained = false);
+bool halPublish(const char* topic, const uint8_t* payload, size_t len, bool retained);
+
+#endif // HAL_H
@@ -0,0 +1,67 @@
+#ifdef ARDUINO
+
+#include "hal.h"
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include "esp_camera.h"
+
+// Built-in LED
+#define LED_GPIO_NUM      21
+
+extern PubSubClient mqtt;
+bool mqttReady();   // main.cpp
+
+uint32_t halMillis() {
+    return millis();
+}
+
+uint32_t halMicros() {
+    return micros();
+}
+
+void halDelay(uint32_t ms) {
+    delay(ms);
+}
+
+bool halCameraGrab(HalFrame* frame) {
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (!fb) return false;
+
+    frame->buf = fb->buf;
+    frame->len = fb->len;
+    frame->width = fb->width;
+    frame->height = fb->height;
+    frame->handle = fb;
+    return true;
+}
+
+void halCameraReturn(HalFrame* frame) {
+    if (frame->handle) {
+        esp_camera_fb_return((camera_fb_t*)frame->handle);
+        frame->handle = nullptr;
+    }
+}
+
+void halLed(bool on) {
+    static bool configured = false;
+    if (!configured) {
+        pinMode(LED_GPIO_NUM, OUTPUT);
+        configured = true;
+    }
+    digitalWrite(LED_GPIO_NUM, on ? HIGH : LOW);
+}
+
+bool halMqttConnected() {
+    return mqttReady();
+}
+
+bool halPublish(const char* topic, const char* payload, bool retained) {
+    return mqttReady() && mqtt.publish(topic, payload, retained);
+}
+
+bool halPublish(const char* topic, const uint8_t* payload, size_t len, bool retained) {
+    return mqttReady() && mqtt.publish(topic, payload, len, retained);
+}
+
+#endif // ARDUINO
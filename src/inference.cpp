@@ -1,12 +1,25 @@
 #include "inference.h"
 #include "config.h"
 #include "model.h"
+#include "log.h"
+#include "preprocess.h"
 
+#include <Arduino.h>
 #include <MicroTFLite.h>
 
+// Headers from train_model.py record the input size the model was trained
+// for (--search can pick 64x64); the placeholder model.h doesn't
+#if defined(POSTURE_MODEL_INPUT_WIDTH) && \
+    (POSTURE_MODEL_INPUT_WIDTH != MODEL_INPUT_WIDTH || POSTURE_MODEL_INPUT_HEIGHT != MODEL_INPUT_HEIGHT)
+#error "model.h was trained for a different input size - set MODEL_INPUT_WIDTH/HEIGHT in config.h"
+#endif
+
 // Tensor arena — allocated statically
 static byte tensorArena[TENSOR_ARENA_SIZE];
 
+// Resized frame, before normalization
+static uint8_t inputPixels[MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT];
+
 bool inferenceSetup() {
     // Check if model data is valid (not just the placeholder 0x00)
     if (posture_model_len <= 1) {
@@ -33,92 +46,48 @@ bool inferenceSetup() {
     return true;
 }
 
-/**
- * Preprocess camera frame and load into model input tensor.
- * 
- * Performs bilinear interpolation to resize from camera resolution
- * (e.g., QVGA 320x240) down to model input size (96x96).
- * 
- * Bilinear interpolation smooths edges and reduces aliasing compared
- * to nearest-neighbor, improving model accuracy.
- * 
- * @param src Source grayscale image buffer
- * @param srcW Source image width
- * @param srcH Source image height
- * @param dstW Destination width (model input width)
- * @param dstH Destination height (model input height)
- */
-static void preprocessAndLoad(const uint8_t* src, int srcW, int srcH,
-                               int dstW, int dstH) {
-    float xScale = (float)srcW / dstW;
-    float yScale = (float)srcH / dstH;
-
-    int idx = 0;
-    for (int y = 0; y < dstH; y++) {
-        // Map destination Y to source Y (float for subpixel accuracy)
-        float srcY = y * yScale;
-        int y0 = (int)srcY;
-        int y1 = min(y0 + 1, srcH - 1);
-        float yFrac = srcY - y0;  // Fractional part for interpolation
-
-        for (int x = 0; x < dstW; x++) {
-            // Map destination X to source X
-            float srcX = x * xScale;
-            int x0 = (int)srcX;
-            int x1 = min(x0 + 1, srcW - 1);
-            float xFrac = srcX - x0;
-
-            // Bilinear interpolation: weighted average of 4 surrounding pixels
-            // (x0,y0)  (x1,y0)
-            //    +------+
-            //    |  *   |  <- interpolated point (srcX, srcY)
-            //    +------+
-            // (x0,y1)  (x1,y1)
-            float val = src[y0 * srcW + x0] * (1 - xFrac) * (1 - yFrac)
-                      + src[y0 * srcW + x1] * xFrac * (1 - yFrac)
-                      + src[y1 * srcW + x0] * (1 - xFrac) * yFrac
-                      + src[y1 * srcW + x1] * xFrac * yFrac;
-
-            // Normalize pixel value to [0,1] range expected by model
-            // ModelSetInput handles INT8 quantization internally
-            ModelSetInput(val / 255.0f, idx);
-            idx++;
-        }
-    }
-}
-
 /**
  * Run TFLite inference on a camera frame.
  * 
  * Pipeline:
  *   1. Preprocess: resize camera frame to model input size (96x96) using
- *      bilinear interpolation and normalize to [0,1]
+ *      bilinear interpolation (preprocess.cpp) and normalize to [0,1]
  *   2. Run TFLite inference (forward pass through CNN)
  *   3. Read output probabilities (INT8 quantized, automatically dequantized)
  *   4. Determine if slouching based on threshold
  * 
- * @param fb Camera frame buffer (must be grayscale format)
+ * @param gray Grayscale frame (width * height bytes)
  * @return InferenceResult containing confidence and classification
  */
-InferenceResult runInference(camera_fb_t* fb) {
-    InferenceResult result = {0.0f, false, 0};
+InferenceResult runInference(const uint8_t* gray, int width, int height) {
+    InferenceResult result = {};
 
-    if (!fb || !fb->buf) {
+    if (!gray) {
         return result;
     }
 
     unsigned long start = millis();
-
-    // Preprocess: resize + normalize + load into input tensor
-    preprocessAndLoad(fb->buf, fb->width, fb->height,
-                      MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+    uint32_t startUs = micros();
+
+    // Preprocess: resize, then normalize into the input tensor.
+    // Same resize as COLLECT_TENSOR training samples.
+    preprocessResize(gray, width, height, inputPixels,
+                     MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+    for (int i = 0; i < MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT; i++) {
+        // ModelSetInput handles INT8 quantization internally
+        ModelSetInput(inputPixels[i] / 255.0f, i);
+    }
+    uint32_t preprocessedUs = micros();
 
     // Run inference (forward pass through the CNN)
     if (!ModelRunInference()) {
-        Serial.println("Inference failed");
+        LOG_ERROR("Inference failed");
         return result;
     }
 
+    result.preprocessUs = preprocessedUs - startUs;
+    result.invokeUs = micros() - preprocessedUs;
+
     // Read output - ModelGetOutput handles INT8 dequantization
     // Class order is alphabetical (training script sorts by folder name): bad=0, good=1
     float bad_conf  = ModelGetOutput(0);
@@ -128,10 +97,12 @@ InferenceResult runInference(camera_fb_t* fb) {
     result.isBadPosture = bad_conf > SLOUCH_THRESHOLD;
     result.inferenceTimeMs = millis() - start;
 
-    #if DEBUG_MODE
-    Serial.printf("Inference: good=%.2f bad=%.2f (%lums)\n",
-                  good_conf, bad_conf, result.inferenceTimeMs);
-    #endif
+    LOG_DEBUG("Inference: good=%.2f bad=%.2f (%lums)",
+              good_conf, bad_conf, result.inferenceTimeMs);
 
     return result;
 }
+
+const uint8_t* inferenceInputPixels() {
+    return inputPixels;
+}
@@ -1,20 +1,27 @@
 #ifndef INFERENCE_H
 #define INFERENCE_H
 
-#include <Arduino.h>
-#include "esp_camera.h"
+#include <stdint.h>
 
 struct InferenceResult {
     float confidence;    // 0.0 = good posture, 1.0 = bad posture
     bool isBadPosture;   // confidence > SLOUCH_THRESHOLD
     unsigned long inferenceTimeMs;
+    // Per-stage timings (captureUs is filled in by processFrame)
+    uint32_t captureUs;
+    uint32_t preprocessUs;
+    uint32_t invokeUs;
 };
 
 // Initialize TFLite interpreter and load model
 bool inferenceSetup();
 
-// Run inference on a camera frame
+// Run inference on an 8-bit grayscale frame
 // Handles preprocessing (resize, normalize) internally
-InferenceResult runInference(camera_fb_t* fb);
+InferenceResult runInference(const uint8_t* gray, int width, int height);
+
+// The resized 8-bit frame the last runInference() fed the model
+// (MODEL_INPUT_WIDTH x MODEL_INPUT_HEIGHT)
+const uint8_t* inferenceInputPixels();
 
 #endif // INFERENCE_H
@@ -0,0 +1,316 @@
+#include "log.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "hal.h"
+#endif
+
+// Ring size in records (power of two). 32 bytes each.
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 256
+#endif
+
+#ifndef LOG_OUTPUT
+#define LOG_OUTPUT LOG_OUTPUT_TEXT
+#endif
+
+#ifndef LOG_MQTT
+#define LOG_MQTT false
+#endif
+
+#define LOG_DRAIN_INTERVAL_MS 20
+
+// Binary wire format (little endian), decoded by scripts/decode_log.py:
+//   0xA5 0x5A | level u8 | nargs u8 | types u8 (2 bits/arg) | 0 | ts_ms u32 | fmt u32 | args u32 x nargs
+// fmt == 0 marks a "records dropped" notice with the count in arg 0.
+#define LOG_SYNC0 0xA5
+#define LOG_SYNC1 0x5A
+#define LOG_FRAME_HEADER 14
+
+struct LogRecord {
+    uint32_t timestampMs;
+    const char* fmt;
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t types;
+    logdetail::ArgValue args[LOG_MAX_ARGS];
+};
+
+// Bounded queue (Vyukov): producers claim a slot with a CAS on the enqueue
+// counter, the sequence number hands the slot to the single consumer.
+struct LogSlot {
+    std::atomic<uint32_t> seq;
+    LogRecord rec;
+};
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+static LogSlot ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> enqueuePos(0);
+static uint32_t dequeuePos = 0;
+static std::atomic<uint32_t> dropped(0);
+static uint32_t droppedReported = 0;
+static bool ringInit = false;
+
+#ifdef ARDUINO
+static portMUX_TYPE batchMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+static uint8_t batch[LOG_BATCH_SIZE];
+static size_t batchLen = 0;
+
+static const char* LEVEL_TAGS[] = { "D", "I", "W", "E" };
+
+static uint32_t nowMs() {
+#ifdef ARDUINO
+    return millis();
+#else
+    // Host builds run under the simulator's virtual clock
+    return halMillis();
+#endif
+}
+
+static void initRing() {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+    ringInit = true;
+}
+
+void logdetail::push(uint8_t level, const char* fmt, const Arg* args, uint8_t nargs) {
+    // First use may come before logSetup() (static init, early setup())
+    if (!ringInit) initRing();
+
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    while (true) {
+        slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // Full - never block the caller
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& r = slot->rec;
+    r.timestampMs = nowMs();
+    r.fmt = fmt;
+    r.level = level;
+    r.nargs = nargs;
+    r.types = 0;
+    for (uint8_t i = 0; i < nargs; i++) {
+        r.args[i] = args[i].v;
+        r.types |= (args[i].type & 0x3) << (i * 2);
+    }
+
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+static bool popRecord(LogRecord* out) {
+    if (!ringInit) return false;
+    LogSlot* slot = &ring[dequeuePos & (LOG_RING_SIZE - 1)];
+    uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    if (seq != dequeuePos + 1) return false;
+
+    *out = slot->rec;
+    slot->seq.store(dequeuePos + LOG_RING_SIZE, std::memory_order_release);
+    dequeuePos++;
+    return true;
+}
+
+static uint8_t argType(const LogRecord& r, int i) {
+    return (r.types >> (i * 2)) & 0x3;
+}
+
+// Expand one record into text. Each conversion is formatted individually
+// with snprintf, after stripping length modifiers (args are all 32-bit).
+static size_t formatRecord(const LogRecord& r, char* out, size_t outLen) {
+    size_t n = snprintf(out, outLen, "[%lu %s] ", (unsigned long)r.timestampMs,
+                        r.level < 4 ? LEVEL_TAGS[r.level] : "?");
+    int argIdx = 0;
+
+    for (const char* p = r.fmt; *p && n < outLen - 1; p++) {
+        if (*p != '%') {
+            out[n++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p++;
+            continue;
+        }
+
+        // Collect flags/width/precision, drop length modifiers
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *p++;
+        while (*p && strchr("-+ #0123456789.*lhzjtL", *p)) {
+            if (!strchr("lhzjtL", *p) && s < sizeof(spec) - 2) spec[s++] = *p;
+            p++;
+        }
+        if (!*p) break;
+        char conv = *p;
+        spec[s++] = conv;
+        spec[s] = '\0';
+
+        size_t room = outLen - n;
+        if (argIdx >= r.nargs) {
+            n += snprintf(out + n, room, "?");
+            continue;
+        }
+
+        const logdetail::ArgValue& v = r.args[argIdx];
+        uint8_t type = argType(r, argIdx++);
+        int w;
+        if (conv == 's') {
+            w = snprintf(out + n, room, spec, type == logdetail::ARG_STR && v.s ? v.s : "?");
+        } else if (strchr("feEgGaA", conv)) {
+            double d = type == logdetail::ARG_FLOAT ? v.f
+                     : type == logdetail::ARG_UINT ? (double)v.u : (double)v.i;
+            w = snprintf(out + n, room, spec, d);
+        } else if (strchr("uxXoc", conv)) {
+            unsigned int u = type == logdetail::ARG_FLOAT ? (unsigned int)v.f : v.u;
+            w = snprintf(out + n, room, spec, u);
+        } else if (conv == 'p') {
+            w = snprintf(out + n, room, spec, (void*)v.s);
+        } else {
+            int i = type == logdetail::ARG_FLOAT ? (int)v.f : v.i;
+            w = snprintf(out + n, room, spec, i);
+        }
+        if (w > 0) n += (size_t)w < room ? (size_t)w : room - 1;
+    }
+
+    if (n >= outLen - 1) n = outLen - 2;
+    if (n > 0 && out[n - 1] != '\n') out[n++] = '\n';
+    out[n] = '\0';
+    return n;
+}
+
+static size_t encodeRecord(const LogRecord& r, uint8_t* out) {
+    out[0] = LOG_SYNC0;
+    out[1] = LOG_SYNC1;
+    out[2] = r.level;
+    out[3] = r.nargs;
+    out[4] = r.types;
+    out[5] = 0;
+    uint32_t fmtAddr = (uint32_t)(uintptr_t)r.fmt;
+    memcpy(out + 6, &r.timestampMs, 4);
+    memcpy(out + 10, &fmtAddr, 4);
+    size_t n = LOG_FRAME_HEADER;
+    for (uint8_t i = 0; i < r.nargs; i++) {
+        uint32_t raw = argType(r, i) == logdetail::ARG_STR ? (uint32_t)(uintptr_t)r.args[i].s
+                                                            : r.args[i].u;
+        memcpy(out + n, &raw, 4);
+        n += 4;
+    }
+    return n;
+}
+
+static void writeOut(const uint8_t* data, size_t len) {
+#ifdef ARDUINO
+    Serial.write(data, len);
+#else
+    // stderr keeps the simulator's stdout free for publish output
+    fwrite(data, 1, len, stderr);
+#endif
+}
+
+static void emit(const LogRecord& r) {
+    uint8_t frame[LOG_FRAME_HEADER + 4 * LOG_MAX_ARGS];
+    size_t frameLen = 0;
+    if (LOG_OUTPUT == LOG_OUTPUT_BINARY || LOG_MQTT) {
+        frameLen = encodeRecord(r, frame);
+    }
+
+    if (LOG_OUTPUT == LOG_OUTPUT_BINARY) {
+        writeOut(frame, frameLen);
+    } else if (r.fmt) {
+        char text[192];
+        size_t n = formatRecord(r, text, sizeof(text));
+        writeOut((const uint8_t*)text, n);
+    } else {
+        char text[48];
+        int n = snprintf(text, sizeof(text), "[log] %lu records dropped\n", (unsigned long)r.args[0].u);
+        writeOut((const uint8_t*)text, n);
+    }
+
+    if (LOG_MQTT) {
+#ifdef ARDUINO
+        portENTER_CRITICAL(&batchMux);
+#endif
+        // MQTT is best effort: records that don't fit before the next publish are lost
+        if (batchLen + frameLen <= sizeof(batch)) {
+            memcpy(batch + batchLen, frame, frameLen);
+            batchLen += frameLen;
+        }
+#ifdef ARDUINO
+        portEXIT_CRITICAL(&batchMux);
+#endif
+    }
+}
+
+void logFlush() {
+    LogRecord r;
+    while (popRecord(&r)) {
+        emit(r);
+    }
+
+    uint32_t d = dropped.load(std::memory_order_relaxed);
+    if (d != droppedReported) {
+        LogRecord notice = {};
+        notice.timestampMs = nowMs();
+        notice.level = LOG_LEVEL_WARN;
+        notice.nargs = 1;
+        notice.types = logdetail::ARG_UINT;
+        notice.args[0].u = d - droppedReported;
+        droppedReported = d;
+        emit(notice);
+    }
+}
+
+#ifdef ARDUINO
+static void logTask(void*) {
+    while (true) {
+        logFlush();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+#endif
+
+void logSetup() {
+    if (!ringInit) initRing();
+#ifdef ARDUINO
+    // Core 0, lowest app priority: formatting and USB CDC writes never run
+    // on the loop task (core 1)
+    xTaskCreatePinnedToCore(logTask, "log", 4096, NULL, 1, NULL, 0);
+#endif
+}
+
+size_t logTakeBatch(uint8_t* out, size_t maxLen) {
+#ifdef ARDUINO
+    portENTER_CRITICAL(&batchMux);
+#endif
+    size_t n = batchLen <= maxLen ? batchLen : 0;
+    if (n) {
+        memcpy(out, batch, n);
+        batchLen = 0;
+    }
+#ifdef ARDUINO
+    portEXIT_CRITICAL(&batchMux);
+#endif
+    return n;
+}
+
+uint32_t logDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,119 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Deferred binary logger
+// ============================================
+//
+// LOG_DEBUG/INFO/WARN/ERROR don't format anything at the call site. They
+// push a 32-byte record (timestamp, format string pointer, up to 4 raw
+// 32-bit args) into a lock-free ring; a low-priority task on core 0 drains
+// it to Serial (formatted text, or raw binary for scripts/decode_log.py)
+// and optionally to an MQTT batch buffer.
+//
+// The format string pointer doubles as the format ID: it points into flash
+// rodata, so the host decoder can look the string up in firmware.elf.
+//
+// Rules for call sites:
+//   - Format must be a string literal
+//   - At most LOG_MAX_ARGS args: integers, floats, bools, or const char*
+//   - %s args must point to static strings (they're dereferenced later,
+//     from another task)
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE  4
+
+#define LOG_OUTPUT_TEXT   0
+#define LOG_OUTPUT_BINARY 1
+
+#define LOG_MAX_ARGS 4
+#define LOG_BATCH_SIZE 1024   // MQTT batch buffer (bytes)
+
+#include "config.h"
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL (DEBUG_MODE ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO)
+#endif
+
+namespace logdetail {
+
+enum : uint8_t { ARG_INT = 0, ARG_UINT = 1, ARG_FLOAT = 2, ARG_STR = 3 };
+
+union ArgValue {
+    uint32_t u;
+    int32_t i;
+    float f;
+    const char* s;
+};
+
+struct Arg {
+    ArgValue v;
+    uint8_t type;
+};
+
+inline Arg pack(int x)                { Arg a; a.v.i = x; a.type = ARG_INT; return a; }
+inline Arg pack(long x)               { Arg a; a.v.i = (int32_t)x; a.type = ARG_INT; return a; }
+inline Arg pack(unsigned int x)       { Arg a; a.v.u = x; a.type = ARG_UINT; return a; }
+inline Arg pack(unsigned long x)      { Arg a; a.v.u = (uint32_t)x; a.type = ARG_UINT; return a; }
+inline Arg pack(bool x)               { Arg a; a.v.i = x ? 1 : 0; a.type = ARG_INT; return a; }
+inline Arg pack(float x)              { Arg a; a.v.f = x; a.type = ARG_FLOAT; return a; }
+inline Arg pack(double x)             { Arg a; a.v.f = (float)x; a.type = ARG_FLOAT; return a; }
+inline Arg pack(const char* x)        { Arg a; a.v.s = x; a.type = ARG_STR; return a; }
+
+void push(uint8_t level, const char* fmt, const Arg* args, uint8_t nargs);
+
+} // namespace logdetail
+
+template <typename... Args>
+inline void logWrite(uint8_t level, const char* fmt, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+    const logdetail::Arg packed[] = { logdetail::pack(args)..., logdetail::pack(0) };
+    logdetail::push(level, fmt, packed, sizeof...(Args));
+}
+
+// Disabled levels compile to nothing - arguments aren't even evaluated
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) logWrite(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) logWrite(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) logWrite(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...) do {} while (0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) logWrite(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) do {} while (0)
+#endif
+
+// Start the drain task. Records pushed before this are kept (up to the
+// ring size) and drained once it runs.
+void logSetup();
+
+// Drain everything pending synchronously (host builds, or before a restart)
+void logFlush();
+
+// Copy out binary records batched for MQTT (LOG_MQTT). `out` must hold
+// LOG_BATCH_SIZE bytes. Returns bytes copied.
+size_t logTakeBatch(uint8_t* out, size_t maxLen);
+
+// Records dropped because the ring was full
+uint32_t logDropped();
+
+#endif // LOG_H
@@ -23,7 +23,17 @@
 #include "esp_camera.h"
 #include "config.h"
 #include "inference.h"
+#include "monitor.h"
 #include "collector.h"
+#include "power.h"
+#include "analytics.h"
+#include "log.h"
+#include "updater.h"
+#include "trace.h"
+#include "debugview.h"
+#if MQTT_USE_TLS
+#include "mqtt_tls.h"
+#endif
 
 // Camera pins for Seeed Studio XIAO ESP32S3 Sense
 #define PWDN_GPIO_NUM     -1
@@ -43,43 +53,36 @@
 #define HREF_GPIO_NUM     47
 #define PCLK_GPIO_NUM     13
 
-// Built-in LED
-#define LED_GPIO_NUM      21
-
-// ============================================
-// State Management
-// ============================================
-enum PostureLevel {
-    LEVEL_GOOD = 0,
-    LEVEL_WARNING = 1,
-    LEVEL_SERIOUS = 2,
-    LEVEL_AGGRESSIVE = 3,
-    LEVEL_AIRHORN = 4
-};
-
-struct PostureState {
-    PostureLevel currentLevel;
-    unsigned long slouchStartTime;
-    unsigned long goodPostureTime;
-    float confidence;   // Model output: 0=good, 1=bad
-    int streak;         // Hours of good posture
-    bool isSlouching;
-} state;
-
 // ============================================
 // Globals
 // ============================================
+#if MQTT_USE_TLS
+TlsClient espClient;
+#else
 WiFiClient espClient;
+#endif
 PubSubClient mqtt(espClient);
 
 DeviceMode currentMode = DEFAULT_MODE;
+DeviceMode pendingMode = DEFAULT_MODE;   // Requested via MQTT, applied in loop()
 
 unsigned long lastFrameTime = 0;
 unsigned long lastMqttPublish = 0;
+unsigned long lastMqttAttempt = 0;
+unsigned long mqttRetryInterval = 0;
+unsigned long mqttReconnects = 0;
 const unsigned long FRAME_INTERVAL = 1000 / FRAME_RATE_FPS;
-const unsigned long MQTT_INTERVAL = 5000;
+const unsigned long MQTT_RETRY_MIN = 2000;
+const unsigned long MQTT_RETRY_MAX = 60000;
 
-bool modelLoaded = false;
+// Connects run on their own task: a TLS handshake or CONNACK wait against a
+// dead broker can take seconds, and the frame loop keeps going meanwhile.
+// While one is in flight the loop task leaves the client alone.
+TaskHandle_t mqttConnectTask = nullptr;
+volatile bool mqttConnecting = false;
+
+bool modelInitTried = false;
+PowerPolicy monitorPowerPolicy = POWER_POLICY;
 
 // ============================================
 // Camera Setup
@@ -109,7 +112,13 @@ bool setupCamera() {
     config.grab_mode = CAMERA_GRAB_LATEST;
     config.fb_location = CAMERA_FB_IN_PSRAM;
 
-    if (currentMode == MODE_COLLECT) {
+    if (currentMode == MODE_COLLECT && COLLECT_FORMAT == COLLECT_TENSOR) {
+        // Same sensor mode as inference - samples match what the model sees.
+        // The stream JPEG-encodes these frames in software.
+        config.pixel_format = PIXFORMAT_GRAYSCALE;
+        config.jpeg_quality = 12;
+        config.fb_count = 2;
+    } else if (currentMode == MODE_COLLECT) {
         // JPEG for web serving — lower number = better quality (4-63)
         config.pixel_format = PIXFORMAT_JPEG;
         config.jpeg_quality = 6;
@@ -150,6 +159,7 @@ bool setupCamera() {
         s->set_dcw(s, 1);               // Downsize enable
     }
 
+    powerCameraActive(true, micros());
     Serial.println("Camera initialized");
     return true;
 }
@@ -174,6 +184,8 @@ void setupWiFi() {
     if (WiFi.status() == WL_CONNECTED) {
         Serial.printf("\nConnected! IP: %s\n", WiFi.localIP().toString().c_str());
         Serial.printf("Signal strength: %d dBm\n", WiFi.RSSI());
+        // Wall clock for dataset timestamps, synced in the background
+        if (strlen(NTP_SERVER) > 0) configTime(0, 0, NTP_SERVER);
     } else {
         Serial.println("\nWiFi connection failed!");
         Serial.println("Check SSID/password in config.h");
@@ -198,7 +210,13 @@ void setupOTA() {
         Serial.println("\nOTA update complete!");
     });
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-        Serial.printf("OTA: %u%%\r", (progress / (total / 100)));
+        // Every chunk calls this - only print on 10% steps
+        static unsigned int lastPct = 100;
+        unsigned int pct = total ? progress * 100ULL / total : 0;
+        if (pct / 10 != lastPct / 10 || pct < lastPct) {
+            lastPct = pct;
+            Serial.printf("OTA: %u%%\n", pct);
+        }
     });
     ArduinoOTA.onError([](ota_error_t error) {
         Serial.printf("OTA Error [%u]: ", error);
@@ -222,165 +240,390 @@ void mqttCallback(char* topic, byte* payload, unsigned int length) {
         String msg;
         for (unsigned int i = 0; i < length; i++) msg += (char)payload[i];
 
+        // Applied from loop() - the camera and HTTP servers can't be torn
+        // down from inside the MQTT client's callback
         if (msg == "collect") {
-            Serial.println("Mode switch to COLLECT requested - restart required");
-            // Can't switch camera format at runtime; signal the need to restart
-            mqtt.publish("posture-pilot/info", "Restart with MODE_COLLECT to collect data");
+            pendingMode = MODE_COLLECT;
+        } else if (msg == "monitor") {
+            pendingMode = MODE_MONITOR;
+        } else {
+            mqtt.publish("posture-pilot/info", "Unknown mode (collect/monitor)");
+        }
+    } else if (strcmp(topic, "posture-pilot/analytics/get") == 0) {
+        // On-demand summary: minute / hour (last 60 min) / day (last 24 h)
+        if (length == 6 && memcmp(payload, "minute", 6) == 0) {
+            publishAnalytics("minute", analyticsLastMinutes(1));
+        } else if (length == 3 && memcmp(payload, "day", 3) == 0) {
+            publishAnalytics("day", analyticsLastHours(ANALYTICS_HOURS));
+        } else {
+            publishAnalytics("hour", analyticsLastMinutes(ANALYTICS_MINUTES));
+        }
+    } else if (strcmp(topic, "posture-pilot/power/set") == 0) {
+        // Switch power policy: performance / balanced / eco
+        char msg[16];
+        unsigned int n = min(length, (unsigned int)sizeof(msg) - 1);
+        memcpy(msg, payload, n);
+        msg[n] = '\0';
+
+        PowerPolicy policy;
+        if (powerParsePolicy(msg, &policy)) {
+            monitorPowerPolicy = policy;
+            // Collect mode always runs at full clock; policy applies on switch back
+            if (currentMode == MODE_MONITOR) powerSetPolicy(policy, micros());
+            mqtt.publish("posture-pilot/info", powerPolicyName(policy));
+        } else {
+            mqtt.publish("posture-pilot/info", "Unknown power policy (performance/balanced/eco)");
+        }
+    } else if (strcmp(topic, "posture-pilot/ota/update") == 0) {
+        // Pull update: payload is the manifest URL (empty = OTA_MANIFEST_URL)
+        char url[160];
+        unsigned int n = min(length, (unsigned int)sizeof(url) - 1);
+        memcpy(url, payload, n);
+        url[n] = '\0';
+
+        const char* manifest = n > 0 ? url : OTA_MANIFEST_URL;
+        if (!updaterUrlAllowed(manifest)) {
+            mqtt.publish("posture-pilot/info", "OTA rejected: manifest URL not allowed");
+        } else if (updaterStart(manifest)) {
+            // Keep the radio and clock up while downloading
+            powerSetPolicy(POWER_PERFORMANCE, micros());
+            mqtt.publish("posture-pilot/info", "OTA update started");
+        } else {
+            mqtt.publish("posture-pilot/info", "OTA update already running");
         }
     }
 }
 
-void reconnectMQTT() {
+/**
+ * Publish connection stats: how long the (re)connect took and, with TLS,
+ * whether the broker resumed the cached session.
+ */
+void publishConnectionStats(unsigned long connectMs) {
+    StaticJsonDocument<192> doc;
+    doc["tls"] = (bool)MQTT_USE_TLS;
+    doc["connect_ms"] = connectMs;
+    doc["reconnects"] = mqttReconnects;
+    #if MQTT_USE_TLS
+    doc["tcp_ms"] = espClient.lastConnectMs();
+    doc["handshake_ms"] = espClient.lastHandshakeMs();
+    doc["resumed"] = espClient.lastResumed();
+    doc["resumed_total"] = espClient.resumedCount();
+    doc["full_total"] = espClient.fullHandshakeCount();
+    #endif
+
+    char buffer[192];
+    serializeJson(doc, buffer);
+    mqtt.publish("posture-pilot/mqtt", buffer);
+}
+
+/**
+ * Connected and not being reconnected by the connect task. Every use of the
+ * client outside that task goes through this.
+ */
+bool mqttReady() {
+    return !mqttConnecting && mqtt.connected();
+}
+
+/**
+ * (Re)connect to the broker. Runs on the connect task.
+ *
+ * Uses a stable client ID and a persistent session (clean session off) so
+ * the broker keeps our subscriptions across reconnects. Commands that act
+ * on the device are subscribed at QoS 0, so the broker doesn't queue them
+ * while we're away - a mode switch or OTA request from hours ago must not
+ * fire on reconnect. Only analytics/get, which just publishes a summary,
+ * is QoS 1.
+ */
+void connectMQTT() {
     if (!mqtt.connected()) {
         Serial.print("Connecting to MQTT...");
 
-        String clientId = MQTT_CLIENT_ID;
-        clientId += String(random(0xffff), HEX);
+        // Stable per-device ID - a persistent session is keyed on it
+        uint8_t mac[6];
+        WiFi.macAddress(mac);
+        char clientId[48];
+        snprintf(clientId, sizeof(clientId), "%s-%02x%02x%02x", MQTT_CLIENT_ID, mac[3], mac[4], mac[5]);
+
+        unsigned long start = millis();
+        if (mqtt.connect(clientId, MQTT_USER, MQTT_PASS, NULL, 0, false, NULL, false)) {
+            unsigned long connectMs = millis() - start;
+            Serial.printf("connected! (%lums)\n", connectMs);
+            mqttRetryInterval = 0;
+            mqttReconnects++;
 
-        if (mqtt.connect(clientId.c_str(), MQTT_USER, MQTT_PASS)) {
-            Serial.println("connected!");
             mqtt.publish("posture-pilot/status", "online");
-            mqtt.subscribe("posture-pilot/mode");
+            // Harmless if the broker already restored them from the session,
+            // and it downgrades ones an older firmware made at QoS 1
+            mqtt.subscribe("posture-pilot/mode", 0);
+            mqtt.subscribe("posture-pilot/power/set", 0);
+            mqtt.subscribe("posture-pilot/analytics/get", 1);
+            mqtt.subscribe("posture-pilot/ota/update", 0);
+            publishConnectionStats(connectMs);
         } else {
             Serial.printf("failed, rc=%d\n", mqtt.state());
+            mqttRetryInterval = mqttRetryInterval == 0 ? MQTT_RETRY_MIN
+                              : min(mqttRetryInterval * 2, MQTT_RETRY_MAX);
         }
     }
 }
 
-void publishState() {
-    if (!mqtt.connected()) return;
+void mqttConnectLoop(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        connectMQTT();
+        mqttConnecting = false;
+    }
+}
+
+/**
+ * Hand a connect attempt to the connect task. Failed attempts back off
+ * exponentially - with TLS a failed handshake costs real CPU time, so we
+ * don't want to burn it every loop.
+ */
+void reconnectMQTT() {
+    if (mqttConnecting) return;
+    if (lastMqttAttempt != 0 && millis() - lastMqttAttempt < mqttRetryInterval) return;
+    lastMqttAttempt = millis();
 
+    mqttConnecting = true;
+    xTaskNotifyGive(mqttConnectTask);
+}
+
+/**
+ * Publish power governor stats for the window since the last call.
+ *
+ * duty        - fraction of wall time spent capturing + running inference
+ * mj_per_inf  - estimated energy per processed frame (CPU + radio)
+ * avg_mw      - estimated average power, including idle time between frames
+ */
+void publishPowerStats() {
+    PowerStats ps = powerTakeStats(micros());
+    if (!mqttReady()) return;
+
+    StaticJsonDocument<192> doc;
+    doc["policy"] = powerPolicyName(powerGetPolicy());
+    doc["duty"] = serialized(String(ps.dutyCycle, 3));
+    doc["avg_mw"] = serialized(String(ps.avgPowerMw, 1));
+    doc["mj_per_inf"] = serialized(String(ps.energyPerInferenceMj, 2));
+    doc["frames"] = ps.frames;
+    doc["cpu_mhz"] = getCpuFrequencyMhz();
+
+    char buffer[192];
+    serializeJson(doc, buffer);
+    mqtt.publish("posture-pilot/power", buffer);
+}
+
+/**
+ * Publish pull-OTA progress to posture-pilot/ota whenever it changes.
+ * Restores the monitor power policy once an update has failed.
+ */
+void publishOtaProgress() {
+    static UpdaterState lastState = UPDATER_IDLE;
+    static uint32_t lastBlocks = 0;
+
+    UpdaterStatus s = updaterGetStatus();
+    if (s.state == lastState && s.blocksDone == lastBlocks) return;
+    if (!mqttReady()) return;
+    lastState = s.state;
+    lastBlocks = s.blocksDone;
+
+    static const char* STATE_NAMES[] = { "idle", "running", "done", "failed" };
     StaticJsonDocument<256> doc;
-    doc["level"] = state.currentLevel;
-    doc["confidence"] = state.confidence;
-    doc["slouching"] = state.isSlouching;
-    doc["streak"] = state.streak;
-    doc["model_loaded"] = modelLoaded;
+    doc["state"] = STATE_NAMES[s.state];
+    doc["blocks"] = s.blocksDone;
+    doc["total"] = s.blocksTotal;
+    doc["bytes"] = s.bytesDownloaded;
+    doc["retries"] = s.retries;
+    doc["resumed"] = s.resumed;
+    if (s.error) doc["error"] = s.error;
 
     char buffer[256];
     serializeJson(doc, buffer);
+    mqtt.publish("posture-pilot/ota", buffer);
 
-    mqtt.publish(TOPIC_STATUS, state.isSlouching ? "slouching" : "good");
-    mqtt.publish(TOPIC_LEVEL, String(state.currentLevel).c_str());
-    mqtt.publish(TOPIC_ANGLE, String(state.confidence, 2).c_str());
-    mqtt.publish(TOPIC_STREAK, String(state.streak).c_str());
-    mqtt.publish("posture-pilot/json", buffer);
+    if (s.state == UPDATER_FAILED && currentMode == MODE_MONITOR) {
+        powerSetPolicy(monitorPowerPolicy, micros());
+    }
+}
 
-    #if DEBUG_MODE
-    Serial.printf("Published: level=%d, conf=%.2f, slouching=%d\n",
-                  state.currentLevel, state.confidence, state.isSlouching);
-    #endif
+#if LOG_MQTT
+// Ship batched binary log records (decode with scripts/decode_log.py)
+void publishLogBatch() {
+    static uint8_t batch[LOG_BATCH_SIZE];
+    size_t n = logTakeBatch(batch, sizeof(batch));
+    if (n > 0 && mqttReady()) {
+        mqtt.publish("posture-pilot/log", batch, n, false);
+    }
 }
+#endif
 
+#if TRACE_RECORD
 // ============================================
-// Escalation Logic
+// Frame Trace Recording
 // ============================================
+WiFiClient traceClient;
+
 /**
- * Update escalation level based on how long the user has been slouching.
- * 
- * Escalation timeline (configurable in config.h):
- *   0-30s:   LEVEL_GOOD (no warning)
- *   30s-2m:  LEVEL_WARNING (gentle reminder)
- *   2m-5m:   LEVEL_SERIOUS (getting annoying)
- *   5m-10m:  LEVEL_AGGRESSIVE (very annoying)
- *   10m+:    LEVEL_AIRHORN (nuclear option)
- * 
- * When posture improves, immediately resets to LEVEL_GOOD and starts
- * tracking a "good posture streak" (published to MQTT in hours).
- * 
- * On level changes, publishes MQTT update and flashes LED (# of flashes = level).
+ * Stream a monitor-mode frame and its model output to scripts/record_trace.py
+ * (host simulator input). Frames are box-downsampled by TRACE_DOWNSAMPLE.
+ * Writes block the frame loop while the socket buffer is full - this is a
+ * recording tool, not something to leave on.
  */
-void updateEscalationLevel() {
-    if (!state.isSlouching) {
-        // Good posture detected — reset escalation
-        state.currentLevel = LEVEL_GOOD;
-        state.slouchStartTime = 0;
-
-        // Track good posture streak (for MQTT streak sensor)
-        if (state.goodPostureTime == 0) {
-            state.goodPostureTime = millis();
-        }
-
-        unsigned long goodDuration = (millis() - state.goodPostureTime) / 1000;
-        state.streak = goodDuration / 3600;  // Convert to hours
-
-        return;
+void recordTraceFrame(const HalFrame& frame, const InferenceResult* result) {
+    static uint8_t* buf = nullptr;
+    static unsigned long lastAttempt = 0;
+
+    if (!traceClient.connected()) {
+        if (lastAttempt != 0 && millis() - lastAttempt < 5000) return;
+        lastAttempt = millis();
+        if (!traceClient.connect(TRACE_HOST, TRACE_PORT)) return;
+
+        uint8_t header[TRACE_FILE_HEADER_SIZE];
+        traceClient.write(header, traceEncodeFileHeader(header));
+        LOG_INFO("Trace recording to %s:%d", TRACE_HOST, TRACE_PORT);
     }
 
-    // Slouching detected — escalate over time
-    state.goodPostureTime = 0;
+    const int f = TRACE_DOWNSAMPLE;
+    int w = frame.width / f;
+    int h = frame.height / f;
+    if (!buf) buf = (uint8_t*)ps_malloc(TRACE_RECORD_HEADER_SIZE + (frame.width * frame.height));
+    if (!buf) return;
+
+    TraceRecordHeader hdr;
+    hdr.timestampMs = millis();
+    hdr.width = w;
+    hdr.height = h;
+    hdr.confidence = result ? result->confidence : NAN;
+    hdr.len = w * h;
+    size_t n = traceEncodeRecordHeader(hdr, buf);
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            unsigned int sum = 0;
+            for (int dy = 0; dy < f; dy++) {
+                const uint8_t* row = frame.buf + (y * f + dy) * frame.width + x * f;
+                for (int dx = 0; dx < f; dx++) sum += row[dx];
+            }
+            buf[n++] = sum / (f * f);
+        }
+    }
 
-    // Start timer on first slouch detection
-    if (state.slouchStartTime == 0) {
-        state.slouchStartTime = millis();
+    if (traceClient.write(buf, n) != n) {
+        traceClient.stop();
     }
+}
+#endif
 
-    unsigned long slouchDuration = (millis() - state.slouchStartTime) / 1000;
+#if TRACE_RECORD || DEBUG_VIEW
+// Monitor-mode frame consumers, each a no-op unless in use
+void onMonitorFrame(const HalFrame& frame, const InferenceResult* result) {
+    #if TRACE_RECORD
+    recordTraceFrame(frame, result);
+    #endif
+    #if DEBUG_VIEW
+    debugViewFrame(frame, result, monitorState());
+    #endif
+}
+#endif
 
-    PostureLevel previousLevel = state.currentLevel;
+// ============================================
+// Mode Switching
+// ============================================
+/**
+ * Load the TFLite model once. The tensor arena is static, so after the
+ * first successful load the model stays resident across mode switches.
+ */
+void ensureModelLoaded() {
+    if (modelInitTried) return;
+    modelInitTried = true;
 
-    // Determine escalation level based on duration
-    if (slouchDuration >= LEVEL4_SECONDS) {
-        state.currentLevel = LEVEL_AIRHORN;
-    } else if (slouchDuration >= LEVEL3_SECONDS) {
-        state.currentLevel = LEVEL_AGGRESSIVE;
-    } else if (slouchDuration >= LEVEL2_SECONDS) {
-        state.currentLevel = LEVEL_SERIOUS;
-    } else if (slouchDuration >= LEVEL1_SECONDS) {
-        state.currentLevel = LEVEL_WARNING;
+    Serial.println("Loading TFLite model...");
+    bool modelLoaded = inferenceSetup();
+    monitorSetModelLoaded(modelLoaded);
+    if (modelLoaded) {
+        Serial.println("Model loaded successfully");
+    } else {
+        Serial.println("Model load failed - running without inference");
+        Serial.println("Flash a trained model or switch to COLLECT mode");
     }
+}
 
-    // Publish immediately on level change (not just on periodic interval)
-    if (state.currentLevel != previousLevel) {
-        Serial.printf("ESCALATION: Level %d -> %d (slouching %lu seconds)\n",
-                      previousLevel, state.currentLevel, slouchDuration);
-        publishState();
-
-        // Visual feedback: flash LED N times where N = escalation level
-        // (e.g., LEVEL_AIRHORN = 4 flashes)
-        for (int i = 0; i <= state.currentLevel; i++) {
-            digitalWrite(LED_GPIO_NUM, HIGH);
-            delay(100);
-            digitalWrite(LED_GPIO_NUM, LOW);
-            delay(100);
-        }
+void enterMode(DeviceMode mode) {
+    if (mode == MODE_MONITOR) {
+        ensureModelLoaded();
+        powerSetPolicy(monitorPowerPolicy, micros());
+
+        // Fresh escalation state - time spent in collect mode doesn't count
+        monitorReset(millis());
+
+        #if DEBUG_VIEW
+        if (!debugViewStart()) Serial.println("Debug view failed to start");
+        #endif
+    } else {
+        // Streaming wants the full clock and an always-on radio
+        powerSetPolicy(POWER_PERFORMANCE, micros());
+        analyticsPause();
+        collectorSetup();
     }
 }
 
-// ============================================
-// Frame Processing (Monitor Mode)
-// ============================================
-void processFrame() {
-    camera_fb_t* fb = esp_camera_fb_get();
-    if (!fb) {
-        Serial.println("Camera capture failed");
-        return;
+/**
+ * Switch between COLLECT and MONITOR without rebooting.
+ *
+ * Stops the collector servers (if leaving collect mode), reinitializes the
+ * camera with the other profile (JPEG VGA x4 buffers vs grayscale QVGA x1),
+ * then starts the new mode. The model is only loaded once and stays resident.
+ * Switch latency is published to posture-pilot/mode/state.
+ */
+void switchMode(DeviceMode mode) {
+    if (mode == currentMode) return;
+
+    unsigned long start = millis();
+    DeviceMode previousMode = currentMode;
+    Serial.printf("Switching mode: %s -> %s\n",
+                  previousMode == MODE_COLLECT ? "COLLECT" : "MONITOR",
+                  mode == MODE_COLLECT ? "COLLECT" : "MONITOR");
+
+    if (previousMode == MODE_COLLECT) {
+        collectorStop();
     }
+    #if DEBUG_VIEW
+    if (previousMode == MODE_MONITOR) {
+        debugViewStop();
+    }
+    #endif
 
-    if (modelLoaded) {
-        InferenceResult result = runInference(fb);
-        state.confidence = result.confidence;
-        state.isSlouching = result.isBadPosture;
-        
-        #if DEBUG_MODE
-        // Print inference stats every 10 frames to avoid log spam
-        static int frameCount = 0;
-        if (++frameCount >= 10) {
-            Serial.printf("Inference: conf=%.2f, slouch=%d, time=%lums\n",
-                          result.confidence, result.isBadPosture, result.inferenceTimeMs);
-            frameCount = 0;
+    esp_camera_deinit();
+    powerCameraActive(false, micros());
+    currentMode = mode;
+    if (!setupCamera()) {
+        // Try to get back to a working camera before giving up
+        Serial.println("Camera reinit failed, reverting mode");
+        currentMode = previousMode;
+        if (!setupCamera()) {
+            Serial.println("Camera unavailable! Restarting...");
+            delay(1000);
+            ESP.restart();
         }
-        #endif
-    } else {
-        // No model loaded - default to good posture
-        // This allows testing without a trained model
-        state.confidence = 0.0f;
-        state.isSlouching = false;
+        enterMode(previousMode);
+        pendingMode = previousMode;
+        if (mqttReady()) mqtt.publish("posture-pilot/info", "Mode switch failed: camera reinit error");
+        return;
     }
 
-    updateEscalationLevel();
+    enterMode(mode);
 
-    esp_camera_fb_return(fb);
+    unsigned long switchMs = millis() - start;
+    Serial.printf("Mode switch took %lums\n", switchMs);
+
+    if (mqttReady()) {
+        StaticJsonDocument<96> doc;
+        doc["mode"] = mode == MODE_COLLECT ? "collect" : "monitor";
+        doc["switch_ms"] = switchMs;
+        char buffer[96];
+        serializeJson(doc, buffer);
+        mqtt.publish("posture-pilot/mode/state", buffer, true);
+    }
 }
 
 // ============================================
@@ -388,21 +631,19 @@ void processFrame() {
 // ============================================
 void setup() {
     Serial.begin(115200);
+    logSetup();
     delay(1000);
     Serial.println("\n\nPosturePilot Starting...");
     Serial.printf("Mode: %s\n", currentMode == MODE_COLLECT ? "COLLECT" : "MONITOR");
 
-    // LED setup
-    pinMode(LED_GPIO_NUM, OUTPUT);
-    digitalWrite(LED_GPIO_NUM, LOW);
+    // LED off
+    halLed(false);
 
     // Initialize state
-    state.currentLevel = LEVEL_GOOD;
-    state.slouchStartTime = 0;
-    state.goodPostureTime = millis();
-    state.confidence = 0;
-    state.streak = 0;
-    state.isSlouching = false;
+    monitorReset(millis());
+    #if TRACE_RECORD || DEBUG_VIEW
+    monitorSetFrameHook(onMonitorFrame);
+    #endif
 
     // Setup camera
     if (!setupCamera()) {
@@ -417,23 +658,30 @@ void setup() {
     // Setup OTA
     setupOTA();
 
-    if (currentMode == MODE_MONITOR) {
-        // Setup MQTT
-        mqtt.setServer(MQTT_SERVER, MQTT_PORT);
-        mqtt.setCallback(mqttCallback);
-
-        // Load TFLite model
-        Serial.println("Loading TFLite model...");
-        modelLoaded = inferenceSetup();
-        if (modelLoaded) {
-            Serial.println("Model loaded successfully");
-        } else {
-            Serial.println("Model load failed - running without inference");
-            Serial.println("Flash a trained model or switch to COLLECT mode");
-        }
-    } else {
-        // Start data collection server
-        collectorSetup();
+    // MQTT runs in both modes so the mode can be switched remotely
+    #if MQTT_USE_TLS
+    espClient.begin(MQTT_CA_CERT, MQTT_TLS_HANDSHAKE_TIMEOUT_MS);
+    mqtt.setServer(MQTT_SERVER, MQTT_TLS_PORT);
+    #else
+    mqtt.setServer(MQTT_SERVER, MQTT_PORT);
+    #endif
+    // Bound the CONNACK wait as well (default is 15s)
+    mqtt.setSocketTimeout(5);
+    // Analytics summaries don't fit the default 256 byte packet buffer
+    mqtt.setBufferSize(LOG_MQTT ? LOG_BATCH_SIZE + 64 : 640);
+
+    analyticsReset(millis());
+    mqtt.setCallback(mqttCallback);
+    // Core 0 with the WiFi stack, below the loop task
+    xTaskCreatePinnedToCore(mqttConnectLoop, "mqtt", 8192, NULL, 1, &mqttConnectTask, 0);
+
+    // Monitor: load model + drop clock between frames
+    // Collect: start data collection servers
+    enterMode(currentMode);
+
+    // Pick up a pull OTA that a reboot or power loss interrupted
+    if (WiFi.status() == WL_CONNECTED && updaterResumePending()) {
+        powerSetPolicy(POWER_PERFORMANCE, micros());
     }
 
     Serial.println("Setup complete!\n");
@@ -446,25 +694,43 @@ void loop() {
     // Handle OTA updates
     ArduinoOTA.handle();
 
-    if (currentMode == MODE_MONITOR) {
-        // Maintain MQTT connection
-        if (!mqtt.connected()) {
-            reconnectMQTT();
-        }
-        mqtt.loop();
+    // Maintain MQTT connection (both modes - carries mode switch requests)
+    if (!mqttConnecting) {
+        if (mqtt.connected()) mqtt.loop();
+        else reconnectMQTT();
+    }
+    publishOtaProgress();
+
+    if (pendingMode != currentMode) {
+        switchMode(pendingMode);
+    }
 
-        // Process frames at target FPS
+    if (currentMode == MODE_MONITOR) {
+        // Process frames at target FPS (clock boosted for the duration)
         unsigned long now = millis();
         if (now - lastFrameTime >= FRAME_INTERVAL) {
             lastFrameTime = now;
+            powerBeginWork(micros());
             processFrame();
+            powerEndWork(micros());
         }
 
-        // Publish state periodically
-        if (now - lastMqttPublish >= MQTT_INTERVAL) {
+        // Publish state periodically (level changes are always published
+        // immediately; raw samples can be turned off in favour of analytics)
+        if (now - lastMqttPublish >= MONITOR_PUBLISH_INTERVAL_MS) {
             lastMqttPublish = now;
+            #if PUBLISH_RAW_STATE
             publishState();
+            #endif
+            publishPowerStats();
+            #if LOG_MQTT
+            publishLogBatch();
+            #endif
         }
+
+        // Sleep until the next frame is due so the governor can idle the CPU
+        unsigned long elapsed = millis() - lastFrameTime;
+        powerIdle(elapsed < FRAME_INTERVAL ? FRAME_INTERVAL - elapsed : 0);
     } else {
         // Collection mode - server handles requests asynchronously
         collectorLoop();
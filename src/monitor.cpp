@@ -0,0 +1,215 @@
+#include "monitor.h"
+#include "config.h"
+#include "log.h"
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+static PostureState state;
+static bool modelLoaded = false;
+static FrameHook frameHook = nullptr;
+
+void monitorReset(uint32_t nowMs) {
+    state.currentLevel = LEVEL_GOOD;
+    state.slouchStartTime = 0;
+    state.goodPostureTime = nowMs;
+    state.confidence = 0;
+    state.streak = 0;
+    state.isSlouching = false;
+}
+
+void monitorSetModelLoaded(bool loaded) {
+    modelLoaded = loaded;
+}
+
+void monitorSetFrameHook(FrameHook hook) {
+    frameHook = hook;
+}
+
+const PostureState& monitorState() {
+    return state;
+}
+
+// ============================================
+// MQTT
+// ============================================
+/**
+ * Publish an analytics summary to posture-pilot/analytics.
+ *
+ * All durations are in seconds. `levels` is time per escalation level,
+ * `conf_hist` is time per 0.1-wide confidence bin (0 = good, 1 = bad).
+ * `open_s` is the length so far of a slouch episode that hasn't ended.
+ */
+void publishAnalytics(const char* window, const AnalyticsSummary& s) {
+    if (!halMqttConnected()) return;
+
+    StaticJsonDocument<512> doc;
+    doc["window"] = window;
+    doc["dur_s"] = s.durationMs / 1000;
+    doc["monitored_s"] = s.monitoredMs / 1000;
+    doc["slouch_s"] = s.slouchMs / 1000;
+    doc["episodes"] = s.episodes;
+    doc["longest_s"] = s.longestEpisodeMs / 1000;
+    doc["open_s"] = s.openEpisodeMs / 1000;
+
+    JsonArray levels = doc.createNestedArray("levels");
+    for (int i = 0; i < ANALYTICS_LEVELS; i++) levels.add(s.levelMs[i] / 1000);
+
+    JsonArray hist = doc.createNestedArray("conf_hist");
+    for (int i = 0; i < ANALYTICS_CONF_BINS; i++) hist.add(s.confMs[i] / 1000);
+
+    char buffer[512];
+    size_t n = serializeJson(doc, buffer);
+    halPublish("posture-pilot/analytics", (const uint8_t*)buffer, n, false);
+}
+
+void publishState() {
+    if (!halMqttConnected()) return;
+
+    StaticJsonDocument<256> doc;
+    doc["level"] = state.currentLevel;
+    doc["confidence"] = state.confidence;
+    doc["slouching"] = state.isSlouching;
+    doc["streak"] = state.streak;
+    doc["model_loaded"] = modelLoaded;
+
+    char buffer[256];
+    serializeJson(doc, buffer);
+
+    char value[16];
+    halPublish(TOPIC_STATUS, state.isSlouching ? "slouching" : "good");
+    snprintf(value, sizeof(value), "%d", (int)state.currentLevel);
+    halPublish(TOPIC_LEVEL, value);
+    snprintf(value, sizeof(value), "%.2f", state.confidence);
+    halPublish(TOPIC_ANGLE, value);
+    snprintf(value, sizeof(value), "%d", state.streak);
+    halPublish(TOPIC_STREAK, value);
+    halPublish("posture-pilot/json", buffer);
+
+    LOG_DEBUG("Published: level=%d, conf=%.2f, slouching=%d",
+              state.currentLevel, state.confidence, state.isSlouching);
+}
+
+// ============================================
+// Escalation Logic
+// ============================================
+/**
+ * Update escalation level based on how long the user has been slouching.
+ *
+ * Escalation timeline (configurable in config.h):
+ *   0-30s:   LEVEL_GOOD (no warning)
+ *   30s-2m:  LEVEL_WARNING (gentle reminder)
+ *   2m-5m:   LEVEL_SERIOUS (getting annoying)
+ *   5m-10m:  LEVEL_AGGRESSIVE (very annoying)
+ *   10m+:    LEVEL_AIRHORN (nuclear option)
+ *
+ * When posture improves, immediately resets to LEVEL_GOOD and starts
+ * tracking a "good posture streak" (published to MQTT in hours).
+ *
+ * On level changes, publishes MQTT update and flashes LED (# of flashes = level).
+ */
+void updateEscalationLevel() {
+    if (!state.isSlouching) {
+        // Good posture detected — reset escalation
+        state.currentLevel = LEVEL_GOOD;
+        state.slouchStartTime = 0;
+
+        // Track good posture streak (for MQTT streak sensor)
+        if (state.goodPostureTime == 0) {
+            state.goodPostureTime = halMillis();
+        }
+
+        unsigned long goodDuration = (halMillis() - state.goodPostureTime) / 1000;
+        state.streak = goodDuration / 3600;  // Convert to hours
+
+        return;
+    }
+
+    // Slouching detected — escalate over time
+    state.goodPostureTime = 0;
+
+    // Start timer on first slouch detection
+    if (state.slouchStartTime == 0) {
+        state.slouchStartTime = halMillis();
+    }
+
+    unsigned long slouchDuration = (halMillis() - state.slouchStartTime) / 1000;
+
+    PostureLevel previousLevel = state.currentLevel;
+
+    // Determine escalation level based on duration
+    if (slouchDuration >= LEVEL4_SECONDS) {
+        state.currentLevel = LEVEL_AIRHORN;
+    } else if (slouchDuration >= LEVEL3_SECONDS) {
+        state.currentLevel = LEVEL_AGGRESSIVE;
+    } else if (slouchDuration >= LEVEL2_SECONDS) {
+        state.currentLevel = LEVEL_SERIOUS;
+    } else if (slouchDuration >= LEVEL1_SECONDS) {
+        state.currentLevel = LEVEL_WARNING;
+    }
+
+    // Publish immediately on level change (not just on periodic interval)
+    if (state.currentLevel != previousLevel) {
+        LOG_INFO("ESCALATION: Level %d -> %d (slouching %lu seconds)",
+                 previousLevel, state.currentLevel, slouchDuration);
+        publishState();
+
+        // Visual feedback: flash LED N times where N = escalation level
+        // (e.g., LEVEL_AIRHORN = 4 flashes)
+        for (int i = 0; i <= state.currentLevel; i++) {
+            halLed(true);
+            halDelay(100);
+            halLed(false);
+            halDelay(100);
+        }
+    }
+}
+
+// ============================================
+// Frame Processing
+// ============================================
+void processFrame() {
+    HalFrame frame;
+    uint32_t grabStart = halMicros();
+    if (!halCameraGrab(&frame)) {
+        LOG_ERROR("Camera capture failed");
+        return;
+    }
+    uint32_t captureUs = halMicros() - grabStart;
+
+    InferenceResult result = {};
+    if (modelLoaded) {
+        result = runInference(frame.buf, frame.width, frame.height);
+        result.captureUs = captureUs;
+        state.confidence = result.confidence;
+        state.isSlouching = result.isBadPosture;
+
+        #if LOG_LEVEL <= LOG_LEVEL_INFO
+        // Print inference stats every 10 frames to avoid log spam
+        static int frameCount = 0;
+        if (++frameCount >= 10) {
+            LOG_INFO("Inference: conf=%.2f, slouch=%d, time=%lums",
+                     result.confidence, result.isBadPosture, result.inferenceTimeMs);
+            frameCount = 0;
+        }
+        #endif
+    } else {
+        // No model loaded - default to good posture
+        // This allows testing without a trained model
+        state.confidence = 0.0f;
+        state.isSlouching = false;
+    }
+
+    updateEscalationLevel();
+
+    // Scheduled summaries: one per completed minute and hour
+    uint8_t done = analyticsSample(halMillis(), state.currentLevel, state.confidence,
+                                   state.isSlouching, modelLoaded);
+    if (done & ANALYTICS_MINUTE_DONE) publishAnalytics("minute", analyticsLastMinutes(1));
+    if (done & ANALYTICS_HOUR_DONE) publishAnalytics("hour", analyticsLastHours(1));
+
+    // After escalation, so hooks see this frame's level
+    if (frameHook) frameHook(frame, modelLoaded ? &result : nullptr);
+
+    halCameraReturn(&frame);
+}
@@ -0,0 +1,59 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdint.h>
+#include "analytics.h"
+#include "hal.h"
+#include "inference.h"
+
+// ============================================
+// Monitor mode: frame -> escalation -> MQTT
+// ============================================
+//
+// Portable - all hardware access goes through hal.h, so the same code runs
+// on the device and in the host simulator (src/sim/).
+
+#define MONITOR_PUBLISH_INTERVAL_MS 5000   // Periodic state publish
+
+enum PostureLevel {
+    LEVEL_GOOD = 0,
+    LEVEL_WARNING = 1,
+    LEVEL_SERIOUS = 2,
+    LEVEL_AGGRESSIVE = 3,
+    LEVEL_AIRHORN = 4
+};
+
+struct PostureState {
+    PostureLevel currentLevel;
+    unsigned long slouchStartTime;
+    unsigned long goodPostureTime;
+    float confidence;   // Model output: 0=good, 1=bad
+    int streak;         // Hours of good posture
+    bool isSlouching;
+};
+
+// Called for every captured frame before it goes back to the camera (trace
+// recording, debug view), after escalation has been updated. `result` is
+// null when running without a model.
+typedef void (*FrameHook)(const HalFrame& frame, const InferenceResult* result);
+
+// Fresh escalation state, e.g. when (re)entering monitor mode
+void monitorReset(uint32_t nowMs);
+
+// Without a model every frame counts as good posture
+void monitorSetModelLoaded(bool loaded);
+
+void monitorSetFrameHook(FrameHook hook);
+
+const PostureState& monitorState();
+
+// Capture one frame, classify it, update escalation and analytics
+void processFrame();
+
+void updateEscalationLevel();
+
+void publishState();
+
+void publishAnalytics(const char* window, const AnalyticsSummary& s);
+
+#endif // MONITOR_H
@@ -0,0 +1,317 @@
+#include "mqtt_tls.h"
+
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#include "esp_system.h"
+
+// mbedTLS RNG callback backed by the hardware RNG (RF subsystem is on, so
+// esp_fill_random() is a true random source here)
+static int hwRandom(void*, unsigned char* out, size_t len) {
+    esp_fill_random(out, len);
+    return 0;
+}
+
+// Runs for each certificate of the chain the broker sends. The broker only
+// sends one in a full handshake, so this tells the two kinds apart whether
+// the session was resumed by ID or by ticket.
+static int onVerify(void* certSeen, mbedtls_x509_crt*, int, uint32_t*) {
+    *(bool*)certSeen = true;
+    return 0;
+}
+
+TlsClient::TlsClient() {
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_net_init(&net);
+    mbedtls_ssl_session_init(&session);
+}
+
+TlsClient::~TlsClient() {
+    stop();
+    mbedtls_ssl_session_free(&session);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ssl_free(&ssl);
+}
+
+bool TlsClient::begin(const char* caCertPem, uint32_t handshakeTimeoutMs) {
+    timeoutMs = handshakeTimeoutMs;
+
+    int ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        Serial.printf("TLS: config defaults failed (-0x%x)\n", -ret);
+        return false;
+    }
+
+    if (caCertPem && caCertPem[0]) {
+        // PEM parsing needs the length including the terminating NUL
+        ret = mbedtls_x509_crt_parse(&ca, (const unsigned char*)caCertPem,
+                                     strlen(caCertPem) + 1);
+        if (ret != 0) {
+            Serial.printf("TLS: CA certificate parse failed (-0x%x)\n", -ret);
+            return false;
+        }
+        mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    } else {
+        Serial.println("TLS: WARNING - no CA certificate, broker identity NOT verified");
+        // OPTIONAL rather than NONE: the chain is still checked (and the
+        // result ignored), so onVerify sees full handshakes here too
+        mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    }
+    mbedtls_ssl_conf_verify(&conf, onVerify, &peerCertSeen);
+
+    mbedtls_ssl_conf_rng(&conf, hwRandom, NULL);
+
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    // Ask for a session ticket - lets the broker resume without keeping
+    // per-client session cache state
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+    // Allocates the record buffers once; reused across reconnects
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) {
+        Serial.printf("TLS: ssl setup failed (-0x%x)\n", -ret);
+        return false;
+    }
+
+    ready = true;
+    return true;
+}
+
+void TlsClient::forgetSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    sessionValid = false;
+}
+
+int TlsClient::openSocket(IPAddress ip, uint16_t port) {
+    int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) return -1;
+
+    // Non-blocking from the start: connect, handshake and I/O are all
+    // bounded by select() timeouts
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+
+    int res = lwip_connect(fd, (struct sockaddr*)&addr, sizeof(addr));
+    if (res < 0 && errno != EINPROGRESS) {
+        lwip_close(fd);
+        return -1;
+    }
+
+    net.fd = fd;
+    if (res < 0 && !waitSocket(true, timeoutMs)) {
+        lwip_close(fd);
+        net.fd = -1;
+        return -1;
+    }
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err != 0) {
+        lwip_close(fd);
+        net.fd = -1;
+        return -1;
+    }
+
+    return fd;
+}
+
+bool TlsClient::waitSocket(bool forWrite, uint32_t waitMs) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(net.fd, &fds);
+    struct timeval tv = { (time_t)(waitMs / 1000), (suseconds_t)((waitMs % 1000) * 1000) };
+    int n = forWrite ? select(net.fd + 1, NULL, &fds, NULL, &tv)
+                     : select(net.fd + 1, &fds, NULL, NULL, &tv);
+    return n > 0;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+    if (!ready) return 0;
+    stop();
+
+    unsigned long start = millis();
+    if (openSocket(ip, port) < 0) {
+        Serial.println("TLS: TCP connect failed");
+        return 0;
+    }
+    connectMs = millis() - start;
+
+    mbedtls_ssl_session_reset(&ssl);
+    if (serverName) mbedtls_ssl_set_hostname(&ssl, serverName);
+    mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    // Offer the cached session - the broker either resumes it (abbreviated
+    // handshake) or silently falls back to a full one
+    bool offered = sessionValid && mbedtls_ssl_set_session(&ssl, &session) == 0;
+    peerCertSeen = false;
+
+    unsigned long hsStart = millis();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            Serial.printf("TLS: handshake failed (-0x%x)\n", -ret);
+            // A rejected session can make some brokers fail hard; retry fresh next time
+            forgetSession();
+            stop();
+            return 0;
+        }
+
+        uint32_t elapsed = millis() - hsStart;
+        if (elapsed >= timeoutMs || !waitSocket(ret == MBEDTLS_ERR_SSL_WANT_WRITE, timeoutMs - elapsed)) {
+            Serial.println("TLS: handshake timed out");
+            stop();
+            return 0;
+        }
+    }
+    handshakeMs = millis() - hsStart;
+
+    // An abbreviated handshake skips the Certificate message. (Comparing
+    // session IDs doesn't work with tickets: the client then sends a fresh
+    // random ID, and the server echoes that.)
+    resumed = offered && !peerCertSeen;
+    if (resumed) resumedTotal++;
+    else fullTotal++;
+
+    // Cache the (possibly new) session for the next reconnect
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    sessionValid = mbedtls_ssl_get_session(&ssl, &session) == 0;
+
+    isConnected = true;
+    return 1;
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!WiFi.hostByName(host, ip)) {
+        Serial.printf("TLS: DNS lookup failed for %s\n", host);
+        return 0;
+    }
+    // Used for SNI and certificate name check
+    serverName = host;
+    return connect(ip, port);
+}
+
+size_t TlsClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+    if (!isConnected) return 0;
+
+    size_t sent = 0;
+    unsigned long start = millis();
+    while (sent < size) {
+        int ret = mbedtls_ssl_write(&ssl, buf + sent, size - sent);
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+        if ((ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) ||
+            millis() - start >= timeoutMs) {
+            stop();
+            break;
+        }
+        waitSocket(ret == MBEDTLS_ERR_SSL_WANT_WRITE, 50);
+    }
+    return sent;
+}
+
+// Try to pull one decrypted byte without blocking. Returns 1 if peekByte
+// was filled, 0 if nothing is pending, -1 if the connection is gone.
+int TlsClient::fillPeek() {
+    if (peekByte >= 0) return 1;
+    if (!isConnected) return -1;
+
+    unsigned char c;
+    int ret = mbedtls_ssl_read(&ssl, &c, 1);
+    if (ret == 1) {
+        peekByte = c;
+        return 1;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return 0;
+    }
+    // Close notify, reset or protocol error
+    stop();
+    return -1;
+}
+
+int TlsClient::available() {
+    if (fillPeek() <= 0) return 0;
+    return 1 + mbedtls_ssl_get_bytes_avail(&ssl);
+}
+
+int TlsClient::read() {
+    if (fillPeek() <= 0) return -1;
+    int c = peekByte;
+    peekByte = -1;
+    return c;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+    if (size == 0) return 0;
+    if (fillPeek() <= 0) return -1;
+
+    buf[0] = peekByte;
+    peekByte = -1;
+    size_t got = 1;
+
+    // Only hand out what's already decrypted - never block here
+    size_t avail = mbedtls_ssl_get_bytes_avail(&ssl);
+    if (avail > size - got) avail = size - got;
+    if (avail > 0) {
+        int ret = mbedtls_ssl_read(&ssl, buf + got, avail);
+        if (ret > 0) got += ret;
+    }
+    return got;
+}
+
+int TlsClient::peek() {
+    if (fillPeek() <= 0) return -1;
+    return peekByte;
+}
+
+void TlsClient::flush() {
+    // Writes go straight to the socket
+}
+
+void TlsClient::stop() {
+    if (net.fd >= 0) {
+        if (isConnected) mbedtls_ssl_close_notify(&ssl);
+        lwip_close(net.fd);
+        net.fd = -1;
+    }
+    isConnected = false;
+    peekByte = -1;
+}
+
+uint8_t TlsClient::connected() {
+    if (!isConnected) return 0;
+    if (peekByte >= 0 || mbedtls_ssl_get_bytes_avail(&ssl) > 0) return 1;
+
+    // Detect a peer close without consuming data
+    char c;
+    int res = lwip_recv(net.fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (res == 0 || (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        stop();
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,83 @@
+#ifndef MQTT_TLS_H
+#define MQTT_TLS_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/net_sockets.h"
+
+/**
+ * TLS transport for PubSubClient with session resumption.
+ *
+ * Differences from WiFiClientSecure:
+ *   - The TLS session (session ID and/or ticket) is kept across reconnects and
+ *     offered to the broker, so a reconnect is an abbreviated handshake with no
+ *     key exchange or certificate chain verification.
+ *   - The mbedTLS context and its record buffers are allocated once in begin()
+ *     and reused, instead of being allocated (and fragmenting the heap) on every
+ *     connect.
+ *   - TCP connect and handshake run on a non-blocking socket with a hard time
+ *     budget, so a dead broker can't stall the loop for longer than that.
+ */
+class TlsClient : public Client {
+public:
+    TlsClient();
+    ~TlsClient();
+
+    // Parse the CA certificate and set up the TLS config. An empty CA
+    // disables certificate verification (test brokers only).
+    bool begin(const char* caCertPem, uint32_t handshakeTimeoutMs);
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    // Stats from the most recent connect()
+    uint32_t lastConnectMs() const { return connectMs; }      // TCP connect
+    uint32_t lastHandshakeMs() const { return handshakeMs; }  // TLS handshake
+    bool lastResumed() const { return resumed; }
+    uint32_t resumedCount() const { return resumedTotal; }
+    uint32_t fullHandshakeCount() const { return fullTotal; }
+
+    // Drop the cached session (e.g. after the broker's cert changed)
+    void forgetSession();
+
+private:
+    int openSocket(IPAddress ip, uint16_t port);
+    bool waitSocket(bool forWrite, uint32_t timeoutMs);
+    int fillPeek();
+
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt ca;
+    mbedtls_net_context net;
+    mbedtls_ssl_session session;
+
+    bool ready = false;
+    bool sessionValid = false;
+    bool isConnected = false;
+    uint32_t timeoutMs = 5000;
+    const char* serverName = nullptr;
+
+    int peekByte = -1;
+
+    uint32_t connectMs = 0;
+    uint32_t handshakeMs = 0;
+    bool peerCertSeen = false;      // Set by the verify callback during a handshake
+    bool resumed = false;
+    uint32_t resumedTotal = 0;
+    uint32_t fullTotal = 0;
+};
+
+#endif // MQTT_TLS_H
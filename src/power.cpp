@@ -0,0 +1,268 @@
+#include "power.h"
+#include "config.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#endif
+
+static PowerPolicy currentPolicy = POWER_PERFORMANCE;
+static PowerProfile currentProfile = {240, 240, 0, false};
+
+// What the hardware actually got: light sleep only counts once esp_pm_configure
+// accepted it, and never while the camera holds its lock
+static bool lightSleepActive = false;
+static bool cameraActive = false;
+
+// Measurement window. Energy is integrated per segment (work, idle, each
+// policy), so a policy change mid-window is charged at the right rate.
+static uint32_t windowStartUs = 0;
+static uint32_t markUs = 0;
+static uint64_t workUs = 0;
+static float energyMj = 0.0f;
+static float workEnergyMj = 0.0f;
+static uint32_t frames = 0;
+static bool windowStarted = false;
+static bool working = false;
+
+#if defined(ARDUINO) && CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t boostLock = NULL;
+static esp_pm_lock_handle_t cameraLock = NULL;
+static bool pmActive = false;
+#endif
+
+PowerProfile powerProfile(PowerPolicy policy) {
+    switch (policy) {
+        case POWER_BALANCED:
+            return {80, 240, 1, false};
+        case POWER_ECO:
+            // 80 MHz is the lowest clock that keeps APB (and the camera XCLK) at 80 MHz
+            return {80, 160, 2, true};
+        case POWER_PERFORMANCE:
+        default:
+            return {240, 240, 0, false};
+    }
+}
+
+/**
+ * Approximate board power in mW (3.3V rail).
+ *
+ * CPU: ~25 mA @ 80 MHz, ~36 mA @ 160 MHz, ~48 mA @ 240 MHz (modem-sleep figures).
+ * Radio: always listening adds ~65 mA; DTIM modem sleep averages ~15 mA,
+ * max modem sleep ~5 mA. Light sleep drops the CPU to ~2 mA.
+ *
+ * Good enough to compare policies against each other, not a substitute for
+ * a power meter.
+ */
+float powerEstimateMw(uint16_t mhz, uint8_t modemSleep, bool asleep) {
+    float cpuMa;
+    if (asleep) {
+        cpuMa = 2.0f;
+    } else if (mhz >= 240) {
+        cpuMa = 48.0f;
+    } else if (mhz >= 160) {
+        cpuMa = 36.0f;
+    } else {
+        cpuMa = 25.0f;
+    }
+
+    float radioMa = modemSleep == 0 ? 65.0f : (modemSleep == 1 ? 15.0f : 5.0f);
+    return (cpuMa + radioMa) * 3.3f;
+}
+
+const char* powerPolicyName(PowerPolicy policy) {
+    switch (policy) {
+        case POWER_BALANCED: return "balanced";
+        case POWER_ECO: return "eco";
+        case POWER_PERFORMANCE:
+        default: return "performance";
+    }
+}
+
+bool powerParsePolicy(const char* name, PowerPolicy* out) {
+    if (strcmp(name, "performance") == 0) *out = POWER_PERFORMANCE;
+    else if (strcmp(name, "balanced") == 0) *out = POWER_BALANCED;
+    else if (strcmp(name, "eco") == 0) *out = POWER_ECO;
+    else return false;
+    return true;
+}
+
+#ifdef ARDUINO
+// Hardware side of a policy change
+static void applyProfile(const PowerProfile& p) {
+    // Modem sleep keeps the AP association (and the MQTT TCP session) alive,
+    // the radio just wakes on DTIM beacons instead of listening continuously
+    if (p.modemSleep == 0) {
+        WiFi.setSleep(false);
+    } else {
+        esp_wifi_set_ps(p.modemSleep == 1 ? WIFI_PS_MIN_MODEM : WIFI_PS_MAX_MODEM);
+    }
+
+#if CONFIG_PM_ENABLE
+    if (p.lightSleep) {
+        if (!boostLock) {
+            esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "frame", &boostLock);
+        }
+
+        esp_pm_config_esp32s3_t pm = {};
+        pm.max_freq_mhz = p.boostMhz;
+        pm.min_freq_mhz = p.idleMhz;
+        pm.light_sleep_enable = true;
+
+        esp_err_t err = esp_pm_configure(&pm);
+        if (err == ESP_ERR_NOT_SUPPORTED) {
+            // SDK built without tickless idle - dynamic frequency only
+            pm.light_sleep_enable = false;
+            err = esp_pm_configure(&pm);
+            Serial.println("Power: light sleep not supported by SDK, using DFS only");
+        }
+        pmActive = (err == ESP_OK);
+        lightSleepActive = pmActive && pm.light_sleep_enable;
+        if (pmActive) return;
+        Serial.printf("Power: esp_pm_configure failed (0x%x), falling back\n", err);
+    } else if (pmActive) {
+        esp_pm_config_esp32s3_t pm = {};
+        pm.max_freq_mhz = p.boostMhz;
+        pm.min_freq_mhz = p.boostMhz;
+        pm.light_sleep_enable = false;
+        esp_pm_configure(&pm);
+        pmActive = false;
+    }
+    lightSleepActive = false;
+#endif
+
+    // No power management in the SDK (or not wanted): switch the clock by hand
+    setCpuFrequencyMhz(p.idleMhz);
+}
+
+static void boostClock(bool on) {
+#if CONFIG_PM_ENABLE
+    if (pmActive) {
+        if (on) esp_pm_lock_acquire(boostLock);
+        else esp_pm_lock_release(boostLock);
+        return;
+    }
+#endif
+    if (currentProfile.idleMhz == currentProfile.boostMhz) return;
+    setCpuFrequencyMhz(on ? currentProfile.boostMhz : currentProfile.idleMhz);
+}
+#else
+static void applyProfile(const PowerProfile&) {}
+static void boostClock(bool) {}
+#endif
+
+// Charge the time since the last mark at the rate of the state we were in
+static void account(uint32_t nowUs) {
+    if (!windowStarted) return;
+    uint32_t dt = nowUs - markUs;
+    markUs = nowUs;
+
+    float mw;
+    if (working) {
+        mw = powerEstimateMw(currentProfile.boostMhz, currentProfile.modemSleep, false);
+    } else {
+        mw = powerEstimateMw(currentProfile.idleMhz, currentProfile.modemSleep,
+                             lightSleepActive && !cameraActive);
+    }
+
+    // mW * us = nJ; / 1e6 -> mJ
+    float mj = mw * (float)dt / 1e6f;
+    energyMj += mj;
+    if (working) {
+        workEnergyMj += mj;
+        workUs += dt;
+    }
+}
+
+void powerSetPolicy(PowerPolicy policy, uint32_t nowUs) {
+    account(nowUs);
+    currentPolicy = policy;
+    currentProfile = powerProfile(policy);
+    applyProfile(currentProfile);
+
+    #if DEBUG_MODE && defined(ARDUINO)
+    Serial.printf("Power policy: %s (idle %u MHz, boost %u MHz, modem sleep %u, light sleep %d)\n",
+                  powerPolicyName(policy), currentProfile.idleMhz, currentProfile.boostMhz,
+                  currentProfile.modemSleep, lightSleepActive);
+    #endif
+}
+
+void powerCameraActive(bool active, uint32_t nowUs) {
+    if (active == cameraActive) return;
+    account(nowUs);
+    cameraActive = active;
+
+#if defined(ARDUINO) && CONFIG_PM_ENABLE
+    // Light sleep gates the LEDC clock behind XCLK and stalls the frame DMA
+    if (!cameraLock) {
+        esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "camera", &cameraLock);
+    }
+    if (cameraLock) {
+        if (active) esp_pm_lock_acquire(cameraLock);
+        else esp_pm_lock_release(cameraLock);
+    }
+#endif
+}
+
+PowerPolicy powerGetPolicy() {
+    return currentPolicy;
+}
+
+void powerBeginWork(uint32_t nowUs) {
+    if (!windowStarted) {
+        windowStartUs = nowUs;
+        markUs = nowUs;
+        windowStarted = true;
+    } else {
+        account(nowUs);
+    }
+    working = true;
+    boostClock(true);
+}
+
+void powerEndWork(uint32_t nowUs) {
+    boostClock(false);
+    account(nowUs);
+    working = false;
+    frames++;
+}
+
+void powerIdle(uint32_t untilNextFrameMs) {
+    if (currentPolicy == POWER_PERFORMANCE || untilNextFrameMs == 0) return;
+    if (untilNextFrameMs > POWER_MAX_IDLE_MS) untilNextFrameMs = POWER_MAX_IDLE_MS;
+#ifdef ARDUINO
+    // delay() blocks the loop task, letting the idle task run (and sleep)
+    delay(untilNextFrameMs);
+#endif
+}
+
+PowerStats powerTakeStats(uint32_t nowUs) {
+    PowerStats stats = {0.0f, 0.0f, 0.0f, frames, 0};
+
+    if (windowStarted) {
+        account(nowUs);
+        uint32_t windowUs = nowUs - windowStartUs;
+        if (windowUs > 0) {
+            uint64_t work = workUs < windowUs ? workUs : windowUs;
+            stats.dutyCycle = (float)work / (float)windowUs;
+            stats.avgPowerMw = energyMj * 1e6f / (float)windowUs;
+            stats.energyPerInferenceMj = frames ? workEnergyMj / frames : 0.0f;
+            stats.windowMs = windowUs / 1000;
+        }
+    }
+
+    // Start a new window
+    windowStartUs = nowUs;
+    markUs = nowUs;
+    windowStarted = true;
+    workUs = 0;
+    energyMj = 0.0f;
+    workEnergyMj = 0.0f;
+    frames = 0;
+
+    return stats;
+}
@@ -0,0 +1,62 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+// Power governor policies (selected via POWER_POLICY in config.h or the
+// posture-pilot/power/set MQTT topic)
+//   PERFORMANCE - full clock, radio always on (original behaviour)
+//   BALANCED    - boost for frame work, drop clock between frames, WiFi modem sleep
+//   ECO         - like BALANCED with deeper modem sleep + automatic light sleep
+enum PowerPolicy { POWER_PERFORMANCE, POWER_BALANCED, POWER_ECO };
+
+struct PowerProfile {
+    uint16_t idleMhz;      // CPU clock between frames
+    uint16_t boostMhz;     // CPU clock during preprocess + invoke
+    uint8_t modemSleep;    // 0 = off, 1 = min (wake every DTIM), 2 = max (listen interval)
+    bool lightSleep;       // Automatic light sleep while idle
+};
+
+struct PowerStats {
+    float dutyCycle;             // Fraction of wall time spent in frame work (0-1)
+    float avgPowerMw;            // Estimated average board power over the window
+    float energyPerInferenceMj;  // Estimated CPU+radio energy per processed frame
+    uint32_t frames;             // Frames processed in the window
+    uint32_t windowMs;           // Length of the measurement window
+};
+
+// Static settings for a policy. Pure function, usable off-device.
+PowerProfile powerProfile(PowerPolicy policy);
+
+// Rough power model (mW) for the ESP32-S3 at a given clock and radio state.
+// Based on datasheet figures; camera and LED are not included.
+float powerEstimateMw(uint16_t mhz, uint8_t modemSleep, bool asleep);
+
+// Apply a policy. On device this configures CPU frequency scaling,
+// WiFi modem sleep and (if the SDK supports it) automatic light sleep.
+// Call after WiFi is up. nowUs closes the accounting segment of the old policy.
+void powerSetPolicy(PowerPolicy policy, uint32_t nowUs);
+PowerPolicy powerGetPolicy();
+const char* powerPolicyName(PowerPolicy policy);
+bool powerParsePolicy(const char* name, PowerPolicy* out);
+
+// Tell the governor the camera is streaming. While it is, a
+// NO_LIGHT_SLEEP lock is held (light sleep would stop XCLK and the frame
+// DMA) and idle time is accounted without light sleep.
+void powerCameraActive(bool active, uint32_t nowUs);
+
+// Bracket one frame of work (capture + preprocess + invoke).
+// Timestamps are in microseconds so the accounting can be driven by a
+// simulated clock on the host.
+void powerBeginWork(uint32_t nowUs);
+void powerEndWork(uint32_t nowUs);
+
+// Sleep until the next frame is due (or POWER_MAX_IDLE_MS, whichever is
+// shorter). Yielding here lets FreeRTOS idle, which is where modem sleep
+// and automatic light sleep kick in. No-op under POWER_PERFORMANCE.
+void powerIdle(uint32_t untilNextFrameMs);
+
+// Stats since the previous call (starts a new measurement window).
+PowerStats powerTakeStats(uint32_t nowUs);
+
+#endif // POWER_H
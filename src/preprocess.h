@@ -0,0 +1,25 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Model input preprocessing
+// ============================================
+//
+// The one resize the model ever sees: inference runs it on every frame,
+// and collect mode (COLLECT_FORMAT COLLECT_TENSOR) stores its output as
+// training samples, so training needs no resize of its own.
+
+// Longest "P5\n<w> <h>\n255\n" header
+#define PGM_HEADER_MAX 20
+
+// Bilinear resize of an 8-bit grayscale image, rounded back to 8 bits
+void preprocessResize(const uint8_t* src, int srcW, int srcH,
+                      uint8_t* dst, int dstW, int dstH);
+
+// Write a binary PGM header, returns its length. The pixels follow it.
+size_t preprocessPgmHeader(uint8_t* out, int width, int height);
+
+#endif // PREPROCESS_H
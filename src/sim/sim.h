@@ -0,0 +1,53 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trace.h"
+
+// ============================================
+// Host simulator internals
+// ============================================
+//
+// The simulator drives the real monitor code (monitor.cpp, analytics.cpp,
+// log.cpp) through sim_hal.cpp: a virtual clock that only moves when the
+// trace or the code (halDelay) says so, frames from a trace file, and
+// publishes to a JSONL mock or a real broker.
+
+struct SimFrame {
+    TraceRecordHeader hdr;
+    uint8_t* data;
+    size_t capacity;
+};
+
+// Virtual clock
+void simSetClock(uint32_t ms);
+
+// Frame returned by the next halCameraGrab() (null = capture fails)
+void simSetFrame(const SimFrame* frame);
+const SimFrame* simCurrentFrame();
+
+// Publish sinks. With neither open, halMqttConnected() is false and
+// nothing is published.
+bool simOpenMockSink(const char* path);           // One JSON object per publish
+bool simOpenMqttSink(const char* host, int port);  // MQTT 3.1.1, QoS 0
+void simCloseSinks();
+
+struct SimCounters {
+    uint32_t publishes;
+    uint32_t publishBytes;
+    uint32_t ledOn;          // LED flashes
+    uint32_t levelChanges[5];
+};
+
+const SimCounters& simCounters();
+
+// storage.h root directory (sim_storage.cpp), default "."
+void simSetStorageRoot(const char* dir);
+
+// Minimal MQTT publisher (sim_mqtt.cpp)
+bool simMqttConnect(const char* host, int port, const char* clientId);
+bool simMqttPublish(const char* topic, const uint8_t* payload, size_t len, bool retained);
+void simMqttDisconnect();
+
+#endif // SIM_H
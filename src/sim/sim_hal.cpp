@@ -0,0 +1,128 @@
+#include "sim.h"
+#include "hal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static uint32_t clockMs = 0;
+static const SimFrame* currentFrame = nullptr;
+static FILE* mockSink = nullptr;
+static bool mqttSink = false;
+static SimCounters counters = {};
+
+void simSetClock(uint32_t ms) {
+    clockMs = ms;
+}
+
+void simSetFrame(const SimFrame* frame) {
+    currentFrame = frame;
+}
+
+const SimFrame* simCurrentFrame() {
+    return currentFrame;
+}
+
+const SimCounters& simCounters() {
+    return counters;
+}
+
+bool simOpenMockSink(const char* path) {
+    mockSink = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    return mockSink != nullptr;
+}
+
+bool simOpenMqttSink(const char* host, int port) {
+    mqttSink = simMqttConnect(host, port, "posture-pilot-sim");
+    return mqttSink;
+}
+
+void simCloseSinks() {
+    if (mockSink && mockSink != stdout) fclose(mockSink);
+    mockSink = nullptr;
+    if (mqttSink) simMqttDisconnect();
+    mqttSink = false;
+}
+
+// ============================================
+// HAL
+// ============================================
+uint32_t halMillis() {
+    return clockMs;
+}
+
+uint32_t halMicros() {
+    return clockMs * 1000;
+}
+
+void halDelay(uint32_t ms) {
+    // Blocking delays in the monitor code cost virtual time only
+    clockMs += ms;
+}
+
+bool halCameraGrab(HalFrame* frame) {
+    if (!currentFrame) return false;
+    frame->buf = currentFrame->data;
+    frame->len = currentFrame->hdr.len;
+    frame->width = currentFrame->hdr.width;
+    frame->height = currentFrame->hdr.height;
+    frame->handle = nullptr;
+    return true;
+}
+
+void halCameraReturn(HalFrame* frame) {
+    frame->buf = nullptr;
+}
+
+void halLed(bool on) {
+    if (on) counters.ledOn++;
+}
+
+bool halMqttConnected() {
+    return mockSink || mqttSink;
+}
+
+static void writeJsonString(FILE* f, const uint8_t* s, size_t len) {
+    fputc('"', f);
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = s[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+bool halPublish(const char* topic, const uint8_t* payload, size_t len, bool retained) {
+    if (!halMqttConnected()) return false;
+
+    counters.publishes++;
+    counters.publishBytes += len;
+    if (strcmp(topic, "posture-pilot/level") == 0 && len == 1 && payload[0] >= '0' && payload[0] <= '4') {
+        // Level topic also goes out periodically - only count real changes
+        static int lastLevel = 0;
+        int level = payload[0] - '0';
+        if (level != lastLevel) counters.levelChanges[level]++;
+        lastLevel = level;
+    }
+
+    if (mockSink) {
+        fprintf(mockSink, "{\"t\":%u,\"topic\":\"%s\",\"retained\":%s,\"payload\":",
+                clockMs, topic, retained ? "true" : "false");
+        writeJsonString(mockSink, payload, len);
+        fputs("}\n", mockSink);
+    }
+    if (mqttSink && !simMqttPublish(topic, payload, len, retained)) {
+        fprintf(stderr, "sim: broker connection lost\n");
+        mqttSink = false;
+    }
+    return true;
+}
+
+bool halPublish(const char* topic, const char* payload, bool retained) {
+    return halPublish(topic, (const uint8_t*)payload, strlen(payload), retained);
+}
@@ -0,0 +1,29 @@
+#include "sim.h"
+#include "inference.h"
+#include "config.h"
+
+#include <math.h>
+
+// TFLite Micro doesn't build for the host, so the simulator replays the
+// model output the device recorded with each frame. That covers everything
+// downstream of the model (escalation, analytics, MQTT), which is what
+// replays are for.
+
+bool inferenceSetup() {
+    // sim_main.cpp only calls this when the trace carries recorded outputs
+    return true;
+}
+
+InferenceResult runInference(const uint8_t* gray, int width, int height) {
+    (void)gray;
+    (void)width;
+    (void)height;
+
+    InferenceResult result = {};
+    const SimFrame* frame = simCurrentFrame();
+    if (frame && !isnan(frame->hdr.confidence)) {
+        result.confidence = frame->hdr.confidence;
+        result.isBadPosture = result.confidence > SLOUCH_THRESHOLD;
+    }
+    return result;
+}
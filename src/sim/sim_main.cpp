@@ -0,0 +1,264 @@
+/**
+ * PosturePilot host simulator
+ *
+ * Replays a frame trace recorded on the device (scripts/record_trace.py)
+ * or generated (scripts/make_trace.py) through the real monitor code under
+ * a virtual clock, as fast as the host can go or at a fixed multiple of
+ * real time.
+ *
+ *   pio run -e native
+ *   .pio/build/native/program --trace day.pptr --out publishes.jsonl
+ *   .pio/build/native/program --trace day.pptr --mqtt localhost --speed 60
+ *   .pio/build/native/program --trace day.pptr --power eco --work-ms 45
+ *
+ * It can also export a dataset log copied off the device's SD card, the
+ * same tar /export serves:
+ *
+ *   .pio/build/native/program --export-dataset /media/sd --out data.tar
+ *
+ * The power governor (power.cpp) accounts every frame against the virtual
+ * clock, with --work-ms standing in for capture + preprocess + invoke, and
+ * publishes posture-pilot/power like the device does.
+ *
+ * The JSONL output is deterministic for a given trace and config, so it
+ * can be diffed against a known-good run after every change.
+ */
+
+#include "sim.h"
+#include "config.h"
+#include "monitor.h"
+#include "analytics.h"
+#include "dataset.h"
+#include "log.h"
+#include "power.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+// Virtual time starts here rather than at 0: the escalation code uses 0 as
+// "timer not running"
+#define SIM_START_MS 1000
+
+// Virtual time one frame of work takes (capture + preprocess + invoke)
+#define SIM_WORK_MS_DEFAULT 60
+
+static void usage() {
+    fprintf(stderr,
+            "usage: program --trace FILE [--out FILE|-] [--mqtt HOST[:PORT]]\n"
+            "               [--speed X] [--no-model] [--quiet]\n"
+            "               [--power performance|balanced|eco] [--work-ms MS]\n"
+            "       program --export-dataset DIR [--out FILE|-]\n"
+            "  --out       write every publish as a JSON line (- = stdout)\n"
+            "  --mqtt      publish to a broker (QoS 0)\n"
+            "  --speed     X times real time (default 0 = as fast as possible)\n"
+            "  --no-model  ignore recorded model output (no-model code path)\n"
+            "  --quiet     drop firmware log output\n"
+            "  --power     power policy (default from config.h)\n"
+            "  --work-ms   virtual time per frame of work (default %d)\n"
+            "  --export-dataset  write DIR" DATASET_PATH " as a tar (default stdout)\n",
+            SIM_WORK_MS_DEFAULT);
+}
+
+static bool writeSink(void* ctx, const void* data, size_t len) {
+    return fwrite(data, 1, len, (FILE*)ctx) == len;
+}
+
+static int exportDataset(const char* dir, const char* outPath) {
+    simSetStorageRoot(dir);
+    if (!datasetBegin()) return 1;
+    FILE* out = !outPath || strcmp(outPath, "-") == 0 ? stdout : fopen(outPath, "wb");
+    if (!out) {
+        fprintf(stderr, "sim: can't open %s\n", outPath);
+        return 1;
+    }
+    bool ok = datasetExport(writeSink, out);
+    if (out != stdout) fclose(out);
+
+    DatasetStats s = datasetStats();
+    fprintf(stderr, "%u records (%u good, %u bad), %u bytes skipped, %u corrupt left out\n",
+            (unsigned)s.records, (unsigned)s.good, (unsigned)s.bad, (unsigned)s.skippedBytes,
+            (unsigned)s.corrupt);
+    return ok ? 0 : 1;
+}
+
+// Same payload as publishPowerStats() in main.cpp
+static void publishPowerStats(PowerStats& total) {
+    PowerStats ps = powerTakeStats(halMicros());
+    char buffer[192];
+    snprintf(buffer, sizeof(buffer),
+             "{\"policy\":\"%s\",\"duty\":%.3f,\"avg_mw\":%.1f,\"mj_per_inf\":%.2f,"
+             "\"frames\":%u,\"cpu_mhz\":%u}",
+             powerPolicyName(powerGetPolicy()), ps.dutyCycle, ps.avgPowerMw,
+             ps.energyPerInferenceMj, (unsigned)ps.frames,
+             (unsigned)powerProfile(powerGetPolicy()).idleMhz);
+    halPublish("posture-pilot/power", buffer);
+
+    // Run totals, weighted by window length
+    total.dutyCycle += ps.dutyCycle * ps.windowMs;
+    total.avgPowerMw += ps.avgPowerMw * ps.windowMs;
+    total.energyPerInferenceMj += ps.energyPerInferenceMj * ps.frames;
+    total.frames += ps.frames;
+    total.windowMs += ps.windowMs;
+}
+
+static bool readRecord(FILE* f, SimFrame* frame) {
+    uint8_t header[TRACE_RECORD_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)) return false;
+    if (!traceDecodeRecordHeader(header, &frame->hdr)) {
+        fprintf(stderr, "sim: corrupt record header\n");
+        return false;
+    }
+    if (frame->hdr.len > frame->capacity) {
+        frame->data = (uint8_t*)realloc(frame->data, frame->hdr.len);
+        frame->capacity = frame->hdr.len;
+    }
+    return fread(frame->data, 1, frame->hdr.len, f) == frame->hdr.len;
+}
+
+int main(int argc, char** argv) {
+    const char* tracePath = nullptr;
+    const char* outPath = nullptr;
+    const char* mqttHost = nullptr;
+    const char* datasetDir = nullptr;
+    double speed = 0;
+    bool noModel = false;
+    bool quiet = false;
+    PowerPolicy policy = POWER_POLICY;
+    uint32_t workMs = SIM_WORK_MS_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(a, "--trace") == 0 && hasValue) tracePath = argv[++i];
+        else if (strcmp(a, "--out") == 0 && hasValue) outPath = argv[++i];
+        else if (strcmp(a, "--mqtt") == 0 && hasValue) mqttHost = argv[++i];
+        else if (strcmp(a, "--speed") == 0 && hasValue) speed = atof(argv[++i]);
+        else if (strcmp(a, "--no-model") == 0) noModel = true;
+        else if (strcmp(a, "--quiet") == 0) quiet = true;
+        else if (strcmp(a, "--export-dataset") == 0 && hasValue) datasetDir = argv[++i];
+        else if (strcmp(a, "--work-ms") == 0 && hasValue) workMs = atoi(argv[++i]);
+        else if (strcmp(a, "--power") == 0 && hasValue && powerParsePolicy(argv[i + 1], &policy)) i++;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (datasetDir) return exportDataset(datasetDir, outPath);
+    if (!tracePath) {
+        usage();
+        return 2;
+    }
+
+    FILE* trace = fopen(tracePath, "rb");
+    uint8_t fileHeader[TRACE_FILE_HEADER_SIZE];
+    if (!trace || fread(fileHeader, 1, sizeof(fileHeader), trace) != sizeof(fileHeader) ||
+        !traceDecodeFileHeader(fileHeader)) {
+        fprintf(stderr, "sim: %s is not a PPTR v%d trace\n", tracePath, TRACE_VERSION);
+        return 1;
+    }
+
+    if (outPath && !simOpenMockSink(outPath)) {
+        fprintf(stderr, "sim: can't open %s\n", outPath);
+        return 1;
+    }
+    if (mqttHost) {
+        char host[128];
+        int port = MQTT_PORT;
+        snprintf(host, sizeof(host), "%s", mqttHost);
+        char* colon = strrchr(host, ':');
+        if (colon) {
+            *colon = '\0';
+            port = atoi(colon + 1);
+        }
+        if (!simOpenMqttSink(host, port)) {
+            fprintf(stderr, "sim: can't connect to broker %s:%d\n", host, port);
+            return 1;
+        }
+    }
+
+    SimFrame frame = {};
+    if (!readRecord(trace, &frame)) {
+        fprintf(stderr, "sim: trace has no frames\n");
+        return 1;
+    }
+
+    // Same order as setup() + enterMode(MODE_MONITOR) on the device
+    uint32_t now = SIM_START_MS;
+    simSetClock(now);
+    monitorReset(now);
+    analyticsReset(now);
+    monitorSetModelLoaded(!noModel && !isnan(frame.hdr.confidence) && inferenceSetup());
+    powerSetPolicy(policy, halMicros());
+    PowerStats powerTotal = {};
+
+    const uint32_t frameInterval = 1000 / FRAME_RATE_FPS;
+    uint32_t prevTs = frame.hdr.timestampMs;
+    uint32_t traceClock = now;
+    uint32_t lastPublish = now;
+    uint32_t frames = 0;
+    auto wallStart = std::chrono::steady_clock::now();
+
+    do {
+        // Map trace time onto the virtual clock. A timestamp going backwards
+        // (device rebooted mid-recording) just continues one frame later.
+        uint32_t delta = frame.hdr.timestampMs - prevTs;
+        if ((int32_t)delta < 0) delta = frameInterval;
+        prevTs = frame.hdr.timestampMs;
+        traceClock += delta;
+
+        // halDelay() inside the monitor code may already have moved past it
+        now = (int32_t)(halMillis() - traceClock) > 0 ? halMillis() : traceClock;
+        simSetClock(now);
+
+        if (speed > 0) {
+            auto due = wallStart + std::chrono::duration<double, std::milli>((now - SIM_START_MS) / speed);
+            std::this_thread::sleep_until(due);
+        }
+
+        // One pass of loop() in monitor mode
+        simSetFrame(&frame);
+        powerBeginWork(halMicros());
+        processFrame();
+        simSetClock(halMillis() + workMs);
+        powerEndWork(halMicros());
+        frames++;
+
+        if (halMillis() - lastPublish >= MONITOR_PUBLISH_INTERVAL_MS) {
+            lastPublish = halMillis();
+            #if PUBLISH_RAW_STATE
+            publishState();
+            #endif
+            publishPowerStats(powerTotal);
+        }
+        now = halMillis();
+
+        if (!quiet) logFlush();
+    } while (readRecord(trace, &frame));
+
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double virtSec = (now - SIM_START_MS) / 1000.0;
+    if (!quiet) logFlush();
+    simCloseSinks();
+    fclose(trace);
+    free(frame.data);
+
+    const SimCounters& c = simCounters();
+    unsigned long v = (unsigned long)virtSec;
+    fprintf(stderr, "sim: %u frames, %luh%02lum%02lus virtual in %.2fs wall (%.0fx real time, %.0f frames/s)\n",
+            frames, v / 3600, v / 60 % 60, v % 60, wallSec,
+            wallSec > 0 ? virtSec / wallSec : 0, wallSec > 0 ? frames / wallSec : 0);
+    fprintf(stderr, "sim: %u publishes (%u bytes), escalations to level 1/2/3/4: %u/%u/%u/%u, LED flashes: %u\n",
+            c.publishes, c.publishBytes, c.levelChanges[1], c.levelChanges[2],
+            c.levelChanges[3], c.levelChanges[4], c.ledOn);
+    if (powerTotal.windowMs > 0) {
+        fprintf(stderr, "sim: power %s: duty cycle %.1f%%, %.1f mW average, %.2f mJ per inference\n",
+                powerPolicyName(policy), 100.0 * powerTotal.dutyCycle / powerTotal.windowMs,
+                powerTotal.avgPowerMw / powerTotal.windowMs,
+                powerTotal.frames ? powerTotal.energyPerInferenceMj / powerTotal.frames : 0.0);
+    }
+    return 0;
+}
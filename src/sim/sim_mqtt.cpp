@@ -0,0 +1,116 @@
+#include "sim.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Just enough MQTT 3.1.1 to publish at QoS 0: CONNECT, PUBLISH, DISCONNECT.
+// Keep-alive is disabled, so a long replay needs no PINGREQs.
+
+static int sock = -1;
+
+static bool sendAll(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(sock, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static size_t encodeLength(uint8_t* out, size_t len) {
+    size_t n = 0;
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        if (len > 0) b |= 0x80;
+        out[n++] = b;
+    } while (len > 0);
+    return n;
+}
+
+static size_t putString(uint8_t* out, const char* s) {
+    size_t len = strlen(s);
+    out[0] = len >> 8;
+    out[1] = len & 0xFF;
+    memcpy(out + 2, s, len);
+    return len + 2;
+}
+
+bool simMqttConnect(const char* host, int port, const char* clientId) {
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%d", port);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res;
+    if (getaddrinfo(host, portStr, &hints, &res) != 0) return false;
+
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock < 0) continue;
+        if (connect(sock, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(sock);
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    if (sock < 0) return false;
+
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // Variable header: protocol name, level 4, clean session, keep-alive 0
+    uint8_t body[128];
+    size_t n = putString(body, "MQTT");
+    body[n++] = 4;
+    body[n++] = 0x02;
+    body[n++] = 0;
+    body[n++] = 0;
+    n += putString(body + n, clientId);
+
+    uint8_t packet[140];
+    size_t p = 0;
+    packet[p++] = 0x10;
+    p += encodeLength(packet + p, n);
+    memcpy(packet + p, body, n);
+    p += n;
+
+    uint8_t connack[4];
+    if (!sendAll(packet, p) || recv(sock, connack, 4, MSG_WAITALL) != 4 ||
+        connack[0] != 0x20 || connack[3] != 0) {
+        close(sock);
+        sock = -1;
+        return false;
+    }
+    return true;
+}
+
+bool simMqttPublish(const char* topic, const uint8_t* payload, size_t len, bool retained) {
+    if (sock < 0) return false;
+
+    size_t topicLen = strlen(topic);
+    uint8_t header[8];
+    size_t h = 0;
+    header[h++] = 0x30 | (retained ? 0x01 : 0x00);
+    h += encodeLength(header + h, 2 + topicLen + len);
+    header[h++] = topicLen >> 8;
+    header[h++] = topicLen & 0xFF;
+
+    return sendAll(header, h) && sendAll((const uint8_t*)topic, topicLen) &&
+           sendAll(payload, len);
+}
+
+void simMqttDisconnect() {
+    if (sock < 0) return;
+    const uint8_t disconnect[2] = { 0xE0, 0x00 };
+    sendAll(disconnect, sizeof(disconnect));
+    close(sock);
+    sock = -1;
+}
@@ -0,0 +1,75 @@
+#include "sim.h"
+#include "storage.h"
+
+#include <stdio.h>
+#include <string>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+// storage.h on a host directory, e.g. a copy of the device's SD card
+
+struct StorageFile {
+    FILE* f;
+};
+
+static std::string root = ".";
+
+void simSetStorageRoot(const char* dir) {
+    root = dir;
+}
+
+static std::string fullPath(const char* path) {
+    return root + path;
+}
+
+bool storageBegin() {
+    return access(root.c_str(), R_OK) == 0;
+}
+
+void storageEnd() {}
+
+const char* storageName() {
+    return "host";
+}
+
+uint64_t storageFreeBytes() {
+    struct statvfs st;
+    if (statvfs(root.c_str(), &st) != 0) return 0;
+    return (uint64_t)st.f_bavail * st.f_frsize;
+}
+
+StorageFile* storageOpen(const char* path, const char* mode) {
+    FILE* f = fopen(fullPath(path).c_str(), mode[0] == 'a' ? "ab" : "rb");
+    if (!f) return nullptr;
+    return new StorageFile{f};
+}
+
+size_t storageRead(StorageFile* f, void* buf, size_t len) {
+    return fread(buf, 1, len, f->f);
+}
+
+size_t storageWrite(StorageFile* f, const void* buf, size_t len) {
+    return fwrite(buf, 1, len, f->f);
+}
+
+bool storageSeek(StorageFile* f, uint32_t pos) {
+    return fseek(f->f, pos, SEEK_SET) == 0;
+}
+
+uint32_t storageSize(StorageFile* f) {
+    long pos = ftell(f->f);
+    fseek(f->f, 0, SEEK_END);
+    long size = ftell(f->f);
+    fseek(f->f, pos, SEEK_SET);
+    return size;
+}
+
+void storageClose(StorageFile* f) {
+    if (!f) return;
+    fclose(f->f);
+    delete f;
+}
+
+bool storageRemove(const char* path) {
+    return remove(fullPath(path).c_str()) == 0 || access(fullPath(path).c_str(), F_OK) != 0;
+}
@@ -0,0 +1,34 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// File storage for the dataset store
+// ============================================
+//
+// Just the calls dataset.cpp needs. storage_esp32.cpp maps them to LittleFS
+// or the microSD card (DATASET_STORAGE), sim/sim_storage.cpp to a directory
+// on the host. Paths are absolute ("/dataset.ppds").
+
+#define STORAGE_LITTLEFS 0
+#define STORAGE_SD 1
+
+struct StorageFile;
+
+bool storageBegin();
+void storageEnd();
+const char* storageName();              // "littlefs", "sd", "host"
+uint64_t storageFreeBytes();
+
+// mode: "r" read, "a" append (created if missing). Null if it can't be opened.
+StorageFile* storageOpen(const char* path, const char* mode);
+size_t storageRead(StorageFile* f, void* buf, size_t len);
+size_t storageWrite(StorageFile* f, const void* buf, size_t len);
+bool storageSeek(StorageFile* f, uint32_t pos);
+uint32_t storageSize(StorageFile* f);
+void storageClose(StorageFile* f);      // Commits appended data
+bool storageRemove(const char* path);
+
+#endif // STORAGE_H
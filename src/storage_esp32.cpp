@@ -0,0 +1,89 @@
+#ifdef ARDUINO
+
+#include "storage.h"
+#include "config.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+#include <SD.h>
+
+struct StorageFile {
+    fs::File file;
+};
+
+static fs::FS* fs = nullptr;
+
+bool storageBegin() {
+    if (fs) return true;
+#if DATASET_STORAGE == STORAGE_SD
+    // Sense expansion board slot (SPI). Its chip select is the user LED pin.
+    if (!SD.begin(SD_CS_PIN)) return false;
+    fs = &SD;
+#else
+    // The "spiffs" data partition, formatted on first use
+    if (!LittleFS.begin(true)) return false;
+    fs = &LittleFS;
+#endif
+    return true;
+}
+
+void storageEnd() {
+    if (!fs) return;
+#if DATASET_STORAGE == STORAGE_SD
+    SD.end();
+#else
+    LittleFS.end();
+#endif
+    fs = nullptr;
+}
+
+const char* storageName() {
+    return DATASET_STORAGE == STORAGE_SD ? "sd" : "littlefs";
+}
+
+uint64_t storageFreeBytes() {
+    if (!fs) return 0;
+#if DATASET_STORAGE == STORAGE_SD
+    return SD.totalBytes() - SD.usedBytes();
+#else
+    return LittleFS.totalBytes() - LittleFS.usedBytes();
+#endif
+}
+
+StorageFile* storageOpen(const char* path, const char* mode) {
+    if (!fs) return nullptr;
+    if (mode[0] == 'r' && !fs->exists(path)) return nullptr;
+    fs::File file = fs->open(path, mode);
+    if (!file) return nullptr;
+    StorageFile* f = new StorageFile;
+    f->file = file;
+    return f;
+}
+
+size_t storageRead(StorageFile* f, void* buf, size_t len) {
+    return f->file.read((uint8_t*)buf, len);
+}
+
+size_t storageWrite(StorageFile* f, const void* buf, size_t len) {
+    return f->file.write((const uint8_t*)buf, len);
+}
+
+bool storageSeek(StorageFile* f, uint32_t pos) {
+    return f->file.seek(pos);
+}
+
+uint32_t storageSize(StorageFile* f) {
+    return f->file.size();
+}
+
+void storageClose(StorageFile* f) {
+    if (!f) return;
+    f->file.close();
+    delete f;
+}
+
+bool storageRemove(const char* path) {
+    return fs && (!fs->exists(path) || fs->remove(path));
+}
+
+#endif // ARDUINO
@@ -0,0 +1,30 @@
+#include "tar.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const uint8_t TAR_ZERO_BLOCK[TAR_BLOCK] = {0};
+
+void tarHeader(uint8_t* block, const char* name, uint32_t size, uint32_t mtime) {
+    char* h = (char*)block;
+    memset(h, 0, TAR_BLOCK);
+    strncpy(h, name, 99);
+    memcpy(h + 100, "0000644", 8);                          // mode
+    memcpy(h + 108, "0000000", 8);                          // uid
+    memcpy(h + 116, "0000000", 8);                          // gid
+    snprintf(h + 124, 12, "%011lo", (unsigned long)size);   // size
+    snprintf(h + 136, 12, "%011lo", (unsigned long)mtime);  // mtime
+    memset(h + 148, ' ', 8);                                // checksum, summed as spaces
+    h[156] = '0';                                           // regular file
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+
+    unsigned sum = 0;
+    for (int i = 0; i < TAR_BLOCK; i++) sum += block[i];
+    snprintf(h + 148, 7, "%06o", sum);
+    h[155] = ' ';
+}
+
+size_t tarPadding(uint32_t size) {
+    return (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+}
@@ -0,0 +1,26 @@
+#ifndef TAR_H
+#define TAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Streaming tar (ustar) writer
+// ============================================
+//
+// Enough of the format to stream regular files whose size is known up
+// front: header block, data, zero padding to the block size, and two zero
+// blocks at the end of the archive. Used by /burst and /export.
+
+#define TAR_BLOCK 512
+
+// Fill a header block for a regular file (name up to 99 chars)
+void tarHeader(uint8_t* block, const char* name, uint32_t size, uint32_t mtime);
+
+// Zero bytes to append after `size` bytes of file data
+size_t tarPadding(uint32_t size);
+
+// TAR_BLOCK zero bytes, for padding and the end-of-archive marker
+extern const uint8_t TAR_ZERO_BLOCK[TAR_BLOCK];
+
+#endif // TAR_H
@@ -0,0 +1,388 @@
+/**
+ * PosturePilot dataset packer
+ *
+ * Turns a training data directory (good/ and bad/ with .jpg or .pgm files,
+ * e.g. an extracted /export or /burst tar) into one packed file of model
+ * inputs that train_model.py memory-maps instead of decoding images:
+ *
+ *   pio run -e packer
+ *   .pio/build/packer/program scripts/data --out scripts/dataset
+ *   python train_model.py --data dataset.json
+ *
+ * JPEGs are decoded to grayscale (the luma channel, what the camera gives
+ * in monitor mode) on every core and resized with preprocessResize(), the
+ * same code the firmware runs before inference. .pgm samples at the model
+ * input size (COLLECT_TENSOR) are copied as they are.
+ *
+ * Exact and near-duplicate frames within a class (a burst of someone
+ * sitting still) are dropped by dHash: a 64-bit hash of brightness
+ * gradients that barely moves with noise or compression. Frames whose
+ * hashes differ in at most --near bits count as duplicates.
+ *
+ * Output:
+ *   dataset.u8    count x height x width pixels, uint8, row-major
+ *   dataset.json  size, classes, labels and per-sample file and SHA-1 -
+ *                 the same file hash train_model.py splits and caches by
+ */
+
+#include "config.h"
+#include "preprocess.h"
+
+#include <atomic>
+#include <algorithm>
+#include <dirent.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jpeglib.h>
+
+#define SAMPLE_SIZE (MODEL_INPUT_WIDTH * MODEL_INPUT_HEIGHT)
+#define NEAR_DEFAULT 2
+
+// Alphabetical, like train_model.py's CLASS_NAMES (bad=0, good=1)
+static const char* CLASSES[] = { "bad", "good" };
+#define CLASS_COUNT 2
+
+struct Sample {
+    std::string path;
+    std::string name;       // class/file, as train_model.py reports it
+    uint8_t label;
+    bool ok;
+    uint64_t dhash;
+    char sha1[41];
+};
+
+static void usage() {
+    fprintf(stderr,
+            "usage: program DATA_DIR [--out STEM] [--threads N] [--near BITS]\n"
+            "  --out      write STEM.u8 and STEM.json (default: dataset)\n"
+            "  --threads  decode threads (default: all cores)\n"
+            "  --near     dHash distance that counts as a duplicate\n"
+            "             (default %d, 0 = identical hashes only)\n", NEAR_DEFAULT);
+}
+
+// ============================================
+// SHA-1 (FIPS 180-1) of the file bytes
+// ============================================
+
+static uint32_t rol(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+static void sha1Block(uint32_t h[5], const uint8_t* p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+               (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+        uint32_t t = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+}
+
+static void sha1Hex(const uint8_t* data, size_t len, char out[41]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    size_t full = len & ~(size_t)63;
+    for (size_t i = 0; i < full; i += 64) sha1Block(h, data + i);
+
+    // Tail, 0x80, zeros and the bit length, in one or two blocks
+    uint8_t tail[128] = {};
+    size_t rest = len - full;
+    memcpy(tail, data + full, rest);
+    tail[rest] = 0x80;
+    size_t tailLen = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) tail[tailLen - 1 - i] = (uint8_t)(bits >> (i * 8));
+    for (size_t i = 0; i < tailLen; i += 64) sha1Block(h, tail + i);
+
+    for (int i = 0; i < 5; i++) snprintf(out + i * 8, 9, "%08x", (unsigned)h[i]);
+}
+
+// ============================================
+// Decoding
+// ============================================
+
+struct JpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+// Grayscale decode, false if it isn't a readable JPEG
+static bool decodeJpeg(const std::vector<uint8_t>& file, std::vector<uint8_t>& gray,
+                       int* width, int* height) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, file.data(), file.size());
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_GRAYSCALE;
+    jpeg_start_decompress(&cinfo);
+
+    *width = cinfo.output_width;
+    *height = cinfo.output_height;
+    gray.resize((size_t)*width * *height);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = gray.data() + (size_t)cinfo.output_scanline * *width;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+// Binary PGM as preprocessPgmHeader() writes it, false otherwise
+static bool decodePgm(const std::vector<uint8_t>& file, std::vector<uint8_t>& gray,
+                      int* width, int* height) {
+    int maxval, offset;
+    std::string head((const char*)file.data(), std::min(file.size(), (size_t)64));
+    if (sscanf(head.c_str(), "P5 %d %d %d%n", width, height, &maxval, &offset) != 3 ||
+        maxval != 255 || *width <= 0 || *height <= 0) {
+        return false;
+    }
+    offset++;   // The single whitespace after maxval
+    size_t n = (size_t)*width * *height;
+    if (file.size() < (size_t)offset + n) return false;
+    gray.assign(file.begin() + offset, file.begin() + offset + n);
+    return true;
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out.resize(len > 0 ? len : 0);
+    bool ok = len > 0 && fread(out.data(), 1, len, f) == (size_t)len;
+    fclose(f);
+    return ok;
+}
+
+// dHash of a model input: 9x8 box averages, one bit per horizontal step
+static uint64_t dhash(const uint8_t* px) {
+    uint32_t cells[8][9] = {};
+    uint32_t counts[8][9] = {};
+    for (int y = 0; y < MODEL_INPUT_HEIGHT; y++) {
+        int cy = y * 8 / MODEL_INPUT_HEIGHT;
+        for (int x = 0; x < MODEL_INPUT_WIDTH; x++) {
+            int cx = x * 9 / MODEL_INPUT_WIDTH;
+            cells[cy][cx] += px[y * MODEL_INPUT_WIDTH + x];
+            counts[cy][cx]++;
+        }
+    }
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            // Compare means without dividing
+            bool brighter = (uint64_t)cells[y][x + 1] * counts[y][x] >
+                            (uint64_t)cells[y][x] * counts[y][x + 1];
+            hash = hash << 1 | brighter;
+        }
+    }
+    return hash;
+}
+
+// Decode, resize and hash one sample into its slot
+static void processSample(Sample& s, uint8_t* out) {
+    std::vector<uint8_t> file, gray;
+    int w, h;
+    s.ok = readFile(s.path, file) &&
+           (decodePgm(file, gray, &w, &h) || decodeJpeg(file, gray, &w, &h));
+    if (!s.ok) return;
+
+    sha1Hex(file.data(), file.size(), s.sha1);
+    if (w == MODEL_INPUT_WIDTH && h == MODEL_INPUT_HEIGHT) {
+        memcpy(out, gray.data(), SAMPLE_SIZE);
+    } else {
+        preprocessResize(gray.data(), w, h, out, MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT);
+    }
+    s.dhash = dhash(out);
+}
+
+// ============================================
+// Packing
+// ============================================
+
+static bool hasSuffix(const char* name, const char* suffix) {
+    size_t n = strlen(name), m = strlen(suffix);
+    return n >= m && strcasecmp(name + n - m, suffix) == 0;
+}
+
+static void listClass(const std::string& dir, uint8_t label, std::vector<Sample>& samples) {
+    std::string classDir = dir + "/" + CLASSES[label];
+    DIR* d = opendir(classDir.c_str());
+    if (!d) return;
+
+    std::vector<std::string> names;
+    while (dirent* e = readdir(d)) {
+        if (hasSuffix(e->d_name, ".jpg") || hasSuffix(e->d_name, ".jpeg") ||
+            hasSuffix(e->d_name, ".pgm")) {
+            names.push_back(e->d_name);
+        }
+    }
+    closedir(d);
+
+    // Sorted, so the kept one of two duplicates doesn't depend on readdir
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+        Sample s = {};
+        s.path = classDir + "/" + name;
+        s.name = std::string(CLASSES[label]) + "/" + name;
+        s.label = label;
+        samples.push_back(s);
+    }
+}
+
+static void writeJsonString(FILE* f, const std::string& s) {
+    fputc('"', f);
+    for (char c : s) {
+        if (c == '"' || c == '\\') fputc('\\', f);
+        fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+static bool writeIndex(const std::string& path, const std::vector<Sample>& samples,
+                       const std::vector<size_t>& kept) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"version\": 1,\n  \"width\": %d,\n  \"height\": %d,\n  \"count\": %zu,\n",
+            MODEL_INPUT_WIDTH, MODEL_INPUT_HEIGHT, kept.size());
+    fprintf(f, "  \"classes\": [\"%s\", \"%s\"],\n  \"labels\": [", CLASSES[0], CLASSES[1]);
+    for (size_t i = 0; i < kept.size(); i++) {
+        fprintf(f, "%s%u", i ? ", " : "", samples[kept[i]].label);
+    }
+    fprintf(f, "],\n  \"files\": [\n");
+    for (size_t i = 0; i < kept.size(); i++) {
+        fprintf(f, "    ");
+        writeJsonString(f, samples[kept[i]].name);
+        fprintf(f, "%s\n", i + 1 < kept.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n  \"sha1\": [\n");
+    for (size_t i = 0; i < kept.size(); i++) {
+        fprintf(f, "    \"%s\"%s\n", samples[kept[i]].sha1, i + 1 < kept.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char** argv) {
+    const char* dataDir = nullptr;
+    std::string out = "dataset";
+    int threads = std::thread::hardware_concurrency();
+    int nearBits = NEAR_DEFAULT;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(a, "--out") == 0 && hasValue) out = argv[++i];
+        else if (strcmp(a, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(a, "--near") == 0 && hasValue) nearBits = atoi(argv[++i]);
+        else if (a[0] != '-' && !dataDir) dataDir = a;
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if (!dataDir) {
+        usage();
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+
+    std::vector<Sample> samples;
+    for (uint8_t label = 0; label < CLASS_COUNT; label++) listClass(dataDir, label, samples);
+    if (samples.empty()) {
+        fprintf(stderr, "pack: no .jpg or .pgm files in %s/bad or %s/good\n", dataDir, dataDir);
+        return 1;
+    }
+
+    // Every sample decodes straight into its own slot, no locking
+    std::vector<uint8_t> pixels(samples.size() * SAMPLE_SIZE);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back([&] {
+            for (size_t i; (i = next++) < samples.size();) {
+                processSample(samples[i], pixels.data() + i * SAMPLE_SIZE);
+            }
+        });
+    }
+    for (std::thread& t : pool) t.join();
+
+    // Keep the first of each group of duplicates, per class
+    std::vector<size_t> kept;
+    size_t failed = 0, exact = 0, nearDup = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        const Sample& s = samples[i];
+        if (!s.ok) {
+            fprintf(stderr, "pack: can't decode %s\n", s.name.c_str());
+            failed++;
+            continue;
+        }
+        const uint8_t* px = pixels.data() + i * SAMPLE_SIZE;
+        bool dup = false;
+        for (size_t k : kept) {
+            const Sample& o = samples[k];
+            if (o.label != s.label || __builtin_popcountll(o.dhash ^ s.dhash) > nearBits) continue;
+            if (memcmp(pixels.data() + k * SAMPLE_SIZE, px, SAMPLE_SIZE) == 0) exact++;
+            else nearDup++;
+            dup = true;
+            break;
+        }
+        if (!dup) kept.push_back(i);
+    }
+
+    std::string u8Path = out + ".u8", jsonPath = out + ".json";
+    FILE* f = fopen(u8Path.c_str(), "wb");
+    if (!f) {
+        fprintf(stderr, "pack: can't open %s\n", u8Path.c_str());
+        return 1;
+    }
+    bool ok = true;
+    for (size_t k : kept) {
+        ok = ok && fwrite(pixels.data() + k * SAMPLE_SIZE, 1, SAMPLE_SIZE, f) == SAMPLE_SIZE;
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok || !writeIndex(jsonPath, samples, kept)) {
+        fprintf(stderr, "pack: write failed\n");
+        return 1;
+    }
+
+    size_t good = std::count_if(kept.begin(), kept.end(),
+                                [&](size_t k) { return samples[k].label == 1; });
+    fprintf(stderr, "%zu samples (%zu good, %zu bad) -> %s, %s\n",
+            kept.size(), good, kept.size() - good, u8Path.c_str(), jsonPath.c_str());
+    fprintf(stderr, "dropped %zu exact and %zu near duplicates, %zu unreadable\n",
+            exact, nearDup, failed);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "trace.h"
+
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t traceEncodeFileHeader(uint8_t* out) {
+    memcpy(out, "PPTR", 4);
+    put16(out + 4, TRACE_VERSION);
+    put16(out + 6, 0);
+    return TRACE_FILE_HEADER_SIZE;
+}
+
+size_t traceEncodeRecordHeader(const TraceRecordHeader& h, uint8_t* out) {
+    uint32_t conf;
+    memcpy(&conf, &h.confidence, 4);
+
+    memcpy(out, "PPFR", 4);
+    put32(out + 4, h.timestampMs);
+    put16(out + 8, h.width);
+    put16(out + 10, h.height);
+    put32(out + 12, conf);
+    put32(out + 16, h.len);
+    return TRACE_RECORD_HEADER_SIZE;
+}
+
+bool traceDecodeFileHeader(const uint8_t* in) {
+    return memcmp(in, "PPTR", 4) == 0 && get16(in + 4) == TRACE_VERSION;
+}
+
+bool traceDecodeRecordHeader(const uint8_t* in, TraceRecordHeader* h) {
+    if (memcmp(in, "PPFR", 4) != 0) return false;
+
+    uint32_t conf = get32(in + 12);
+    h->timestampMs = get32(in + 4);
+    h->width = get16(in + 8);
+    h->height = get16(in + 10);
+    memcpy(&h->confidence, &conf, 4);
+    h->len = get32(in + 16);
+    return h->len == (uint32_t)h->width * h->height;
+}
@@ -0,0 +1,41 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ============================================
+// Frame trace format
+// ============================================
+//
+// Recorded on the device (TRACE_RECORD -> scripts/record_trace.py) and
+// replayed by the host simulator. Little endian:
+//
+//   file header: "PPTR" | version u16 | reserved u16
+//   record:      "PPFR" | ts_ms u32 | width u16 | height u16 |
+//                confidence f32 | len u32 | len bytes 8-bit grayscale
+//
+// `confidence` is the model output the device computed for the frame, or
+// NaN if it ran without a model. The simulator replays it, since TFLite
+// Micro doesn't build for the host.
+
+#define TRACE_VERSION 1
+#define TRACE_FILE_HEADER_SIZE 8
+#define TRACE_RECORD_HEADER_SIZE 20
+
+struct TraceRecordHeader {
+    uint32_t timestampMs;
+    uint16_t width;
+    uint16_t height;
+    float confidence;
+    uint32_t len;
+};
+
+size_t traceEncodeFileHeader(uint8_t* out);
+size_t traceEncodeRecordHeader(const TraceRecordHeader& h, uint8_t* out);
+
+// Return false on bad magic / unsupported version
+bool traceDecodeFileHeader(const uint8_t* in);
+bool traceDecodeRecordHeader(const uint8_t* in, TraceRecordHeader* h);
+
+#endif // TRACE_H
@@ -0,0 +1,458 @@
+#include "updater.h"
+#include "config.h"
+#include "log.h"
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/pk.h"
+#include "esp32s3/rom/miniz.h"
+
+#define UPDATER_MAX_BLOCKS 96            // 6 MB at 64 KB blocks
+#define UPDATER_HTTP_TIMEOUT_MS 10000
+#define UPDATER_MAX_SIG 80               // DER ECDSA P-256 signature is at most 72 bytes
+#define UPDATER_MAX_MANIFEST (24 * 1024) // ~130 bytes per block entry
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+// pack_ota.py finds the build number in the image by this tag. Read back
+// at runtime, so the linker can't drop it.
+static const char buildTag[] = "PPBUILD=" STR(FIRMWARE_BUILD);
+
+static uint32_t runningBuild() {
+    return strtoul(strchr(buildTag, '=') + 1, NULL, 10);
+}
+
+struct BlockInfo {
+    uint32_t offset;        // Offset in the .ppota file
+    uint32_t length;        // Compressed length
+    uint8_t sha[32];        // SHA-256 of the decompressed block
+};
+
+struct Manifest {
+    char url[160];
+    uint32_t imageSize;
+    uint32_t blockSize;
+    uint8_t imageSha[32];
+    char imageShaHex[65];
+    uint32_t blockCount;
+    BlockInfo blocks[UPDATER_MAX_BLOCKS];
+};
+
+static portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
+static UpdaterStatus status = {UPDATER_IDLE, 0, 0, 0, 0, false, nullptr};
+static char manifestUrl[160];
+
+static void setStatus(const UpdaterStatus& s) {
+    portENTER_CRITICAL(&statusMux);
+    status = s;
+    portEXIT_CRITICAL(&statusMux);
+}
+
+UpdaterStatus updaterGetStatus() {
+    portENTER_CRITICAL(&statusMux);
+    UpdaterStatus s = status;
+    portEXIT_CRITICAL(&statusMux);
+    return s;
+}
+
+static bool parseHex(const char* hex, uint8_t* out, size_t len) {
+    if (!hex || strlen(hex) != len * 2) return false;
+    for (size_t i = 0; i < len; i++) {
+        char b[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+        char* end;
+        out[i] = (uint8_t)strtoul(b, &end, 16);
+        if (*end) return false;
+    }
+    return true;
+}
+
+// Resolve a (possibly relative) image URL against the manifest URL
+static void resolveUrl(const char* base, const char* ref, char* out, size_t outLen) {
+    if (strncmp(ref, "http://", 7) == 0 || strncmp(ref, "https://", 8) == 0) {
+        snprintf(out, outLen, "%s", ref);
+        return;
+    }
+    const char* slash = strrchr(base, '/');
+    int dirLen = slash ? (int)(slash - base + 1) : 0;
+    snprintf(out, outLen, "%.*s%s", dirLen, base, ref);
+}
+
+// Length of "scheme://host[:port]"
+static size_t originLength(const char* url) {
+    const char* host = strstr(url, "://");
+    if (!host) return 0;
+    const char* path = strchr(host + 3, '/');
+    return path ? (size_t)(path - url) : strlen(url);
+}
+
+bool updaterUrlAllowed(const char* url) {
+    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) return false;
+    // A signed manifest vouches for itself, wherever it comes from
+    if (OTA_PUBLIC_KEY[0]) return true;
+
+    size_t n = originLength(url);
+    return n > 0 && n == originLength(OTA_MANIFEST_URL) && strncasecmp(url, OTA_MANIFEST_URL, n) == 0;
+}
+
+static bool httpGet(const char* url, String& body) {
+    HTTPClient http;
+    http.setTimeout(UPDATER_HTTP_TIMEOUT_MS);
+    if (!http.begin(url)) return false;
+    bool ok = http.GET() == HTTP_CODE_OK;
+    if (ok) body = http.getString();
+    http.end();
+    return ok;
+}
+
+// ECDSA signature (hex DER in <manifest URL>.sig) over the manifest bytes
+static bool verifyManifest(const String& body, const char** error) {
+    char sigUrl[sizeof(manifestUrl) + 4];
+    snprintf(sigUrl, sizeof(sigUrl), "%s.sig", manifestUrl);
+    String sigHex;
+    if (!httpGet(sigUrl, sigHex)) {
+        *error = "manifest signature download failed";
+        return false;
+    }
+    sigHex.trim();
+    uint8_t sig[UPDATER_MAX_SIG];
+    size_t sigLen = sigHex.length() / 2;
+    if (sigLen == 0 || sigLen > sizeof(sig) || !parseHex(sigHex.c_str(), sig, sigLen)) {
+        *error = "invalid manifest signature";
+        return false;
+    }
+
+    uint8_t hash[32];
+    mbedtls_sha256_ret((const uint8_t*)body.c_str(), body.length(), hash, 0);
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    // PEM parsing wants the terminating NUL in the length
+    bool ok = mbedtls_pk_parse_public_key(&pk, (const uint8_t*)OTA_PUBLIC_KEY,
+                                          sizeof(OTA_PUBLIC_KEY)) == 0 &&
+              mbedtls_pk_verify(&pk, MBEDTLS_MD_SHA256, hash, sizeof(hash), sig, sigLen) == 0;
+    mbedtls_pk_free(&pk);
+    if (!ok) *error = "manifest signature mismatch";
+    return ok;
+}
+
+static bool fetchManifest(Manifest* m, const char** error) {
+    String body;
+    if (!httpGet(manifestUrl, body)) {
+        *error = "manifest download failed";
+        return false;
+    }
+    if (body.length() > UPDATER_MAX_MANIFEST) {
+        *error = "manifest too large";
+        return false;
+    }
+    if (OTA_PUBLIC_KEY[0] && !verifyManifest(body, error)) return false;
+
+    // Parsing from a String copies every string (the block hashes above
+    // all), so the body length bounds what those take
+    DynamicJsonDocument doc(JSON_OBJECT_SIZE(8) + JSON_ARRAY_SIZE(UPDATER_MAX_BLOCKS) +
+                            UPDATER_MAX_BLOCKS * JSON_OBJECT_SIZE(3) + body.length());
+    DeserializationError err = deserializeJson(doc, body);
+    if (err) {
+        *error = "manifest parse error";
+        return false;
+    }
+
+    uint32_t build = doc["build"] | 0;
+    if (build <= runningBuild()) {
+        LOG_WARN("OTA: manifest build %u, running %u", build, runningBuild());
+        *error = "manifest not newer than running firmware";
+        return false;
+    }
+
+    m->imageSize = doc["image_size"] | 0;
+    m->blockSize = doc["block_size"] | 0;
+    const char* sha = doc["image_sha256"] | "";
+    const char* url = doc["url"] | "";
+    JsonArray blocks = doc["blocks"];
+
+    if (strcmp(doc["compression"] | "", "deflate") != 0 ||
+        !parseHex(sha, m->imageSha, 32) || !url[0] ||
+        m->imageSize == 0 || m->blockSize == 0 || m->blockSize % 4096 != 0 ||
+        blocks.size() == 0 || blocks.size() > UPDATER_MAX_BLOCKS ||
+        blocks.size() != (m->imageSize + m->blockSize - 1) / m->blockSize) {
+        *error = "invalid manifest";
+        return false;
+    }
+
+    snprintf(m->imageShaHex, sizeof(m->imageShaHex), "%s", sha);
+    resolveUrl(manifestUrl, url, m->url, sizeof(m->url));
+    m->blockCount = blocks.size();
+    for (uint32_t i = 0; i < m->blockCount; i++) {
+        m->blocks[i].offset = blocks[i]["offset"] | 0;
+        m->blocks[i].length = blocks[i]["length"] | 0;
+        if (!parseHex(blocks[i]["sha256"] | "", m->blocks[i].sha, 32) || m->blocks[i].length == 0) {
+            *error = "invalid block entry";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Download one compressed block with a Range request
+static bool fetchBlock(const char* url, const BlockInfo& b, uint8_t* out) {
+    HTTPClient http;
+    http.setTimeout(UPDATER_HTTP_TIMEOUT_MS);
+    if (!http.begin(url)) return false;
+
+    char range[48];
+    snprintf(range, sizeof(range), "bytes=%u-%u", b.offset, b.offset + b.length - 1);
+    http.addHeader("Range", range);
+
+    int code = http.GET();
+    if (code != HTTP_CODE_PARTIAL_CONTENT) {
+        http.end();
+        return false;
+    }
+
+    WiFiClient* stream = http.getStreamPtr();
+    uint32_t got = 0;
+    unsigned long lastData = millis();
+    while (got < b.length && millis() - lastData < UPDATER_HTTP_TIMEOUT_MS) {
+        size_t avail = stream->available();
+        if (avail == 0) {
+            if (!http.connected()) break;
+            delay(2);
+            continue;
+        }
+        int n = stream->readBytes(out + got, min((size_t)(b.length - got), avail));
+        if (n > 0) {
+            got += n;
+            lastData = millis();
+        }
+    }
+    http.end();
+    return got == b.length;
+}
+
+static bool inflateBlock(tinfl_decompressor* d, const uint8_t* in, size_t inLen,
+                         uint8_t* out, size_t expectedLen) {
+    tinfl_init(d);
+    size_t inBytes = inLen;
+    size_t outBytes = expectedLen;
+    tinfl_status st = tinfl_decompress(d, in, &inBytes, out, out, &outBytes,
+                                       TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    return st == TINFL_STATUS_DONE && outBytes == expectedLen;
+}
+
+static void sha256(const uint8_t* data, size_t len, uint8_t* out) {
+    mbedtls_sha256_ret(data, len, out, 0);
+}
+
+static bool writeAndVerify(const esp_partition_t* part, uint32_t offset,
+                           const uint8_t* data, size_t len, const uint8_t* sha,
+                           uint8_t* scratch) {
+    // Block size is a multiple of the 4 KB sector; the last block may be
+    // short but still starts on a sector boundary
+    size_t eraseLen = (len + 4095) & ~4095u;
+    if (esp_partition_erase_range(part, offset, eraseLen) != ESP_OK) return false;
+    if (esp_partition_write(part, offset, data, len) != ESP_OK) return false;
+
+    // Read back - a block only counts as done once flash holds the right bytes
+    uint8_t check[32];
+    if (esp_partition_read(part, offset, scratch, len) != ESP_OK) return false;
+    sha256(scratch, len, check);
+    return memcmp(check, sha, 32) == 0;
+}
+
+static bool verifyImage(const esp_partition_t* part, const Manifest& m, uint8_t* scratch) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    for (uint32_t off = 0; off < m.imageSize; off += m.blockSize) {
+        uint32_t n = min(m.blockSize, m.imageSize - off);
+        if (esp_partition_read(part, off, scratch, n) != ESP_OK) {
+            mbedtls_sha256_free(&ctx);
+            return false;
+        }
+        mbedtls_sha256_update_ret(&ctx, scratch, n);
+    }
+    uint8_t sha[32];
+    mbedtls_sha256_finish_ret(&ctx, sha);
+    mbedtls_sha256_free(&ctx);
+    return memcmp(sha, m.imageSha, 32) == 0;
+}
+
+static void fail(UpdaterStatus& s, const char* error) {
+    s.state = UPDATER_FAILED;
+    s.error = error;
+    setStatus(s);
+    LOG_ERROR("OTA failed: %s", error);
+}
+
+static void updaterTask(void*) {
+    UpdaterStatus s = {UPDATER_RUNNING, 0, 0, 0, 0, false, nullptr};
+    setStatus(s);
+
+    Manifest* m = (Manifest*)ps_malloc(sizeof(Manifest));
+    uint8_t* compressed = nullptr;
+    uint8_t* block = nullptr;
+    uint8_t* scratch = nullptr;
+    tinfl_decompressor* inflater = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    const char* error = nullptr;
+    Preferences prefs;
+    const esp_partition_t* part = nullptr;
+    uint32_t start = 0;
+
+    if (!m || !inflater) {
+        fail(s, "out of memory");
+        goto cleanup;
+    }
+
+    if (!fetchManifest(m, &error)) {
+        fail(s, error);
+        goto cleanup;
+    }
+
+    part = esp_ota_get_next_update_partition(NULL);
+    if (!part) {
+        fail(s, "no OTA partition (needs a two-slot partition table)");
+        goto cleanup;
+    }
+    if (m->imageSize > part->size) {
+        fail(s, "image larger than partition");
+        goto cleanup;
+    }
+
+    compressed = (uint8_t*)ps_malloc(m->blockSize + m->blockSize / 8 + 64);
+    block = (uint8_t*)ps_malloc(m->blockSize);
+    scratch = (uint8_t*)ps_malloc(m->blockSize);
+    if (!compressed || !block || !scratch) {
+        fail(s, "out of memory");
+        goto cleanup;
+    }
+
+    // Resume if NVS says we were part-way through this exact image on this slot
+    prefs.begin("ota", false);
+    if (prefs.getString("sha", "") == m->imageShaHex &&
+        prefs.getString("part", "") == part->label) {
+        start = prefs.getUInt("done", 0);
+        if (start > m->blockCount) start = 0;
+        s.resumed = start > 0;
+    } else {
+        prefs.putString("sha", m->imageShaHex);
+        prefs.putString("part", part->label);
+        prefs.putString("url", manifestUrl);
+        prefs.putUInt("done", 0);
+    }
+
+    s.blocksTotal = m->blockCount;
+    s.blocksDone = start;
+    setStatus(s);
+    LOG_INFO("OTA: %u blocks, starting at %u (%s)", m->blockCount, start, part->label);
+
+    for (uint32_t i = start; i < m->blockCount; i++) {
+        const BlockInfo& b = m->blocks[i];
+        uint32_t rawLen = min(m->blockSize, m->imageSize - i * m->blockSize);
+        bool ok = false;
+
+        for (int attempt = 0; attempt < OTA_BLOCK_RETRIES && !ok; attempt++) {
+            if (attempt > 0) {
+                s.retries++;
+                setStatus(s);
+                delay(1000 << min(attempt, 4));   // 2s .. 16s
+            }
+            if (b.length > m->blockSize + m->blockSize / 8 + 64) break;
+            if (WiFi.status() != WL_CONNECTED) continue;
+            if (!fetchBlock(m->url, b, compressed)) continue;
+            s.bytesDownloaded += b.length;
+
+            if (!inflateBlock(inflater, compressed, b.length, block, rawLen)) continue;
+            uint8_t sha[32];
+            sha256(block, rawLen, sha);
+            if (memcmp(sha, b.sha, 32) != 0) continue;
+
+            ok = writeAndVerify(part, i * m->blockSize, block, rawLen, b.sha, scratch);
+        }
+
+        if (!ok) {
+            // Progress so far stays in NVS - the next attempt resumes here
+            fail(s, "block failed after retries");
+            goto cleanup;
+        }
+
+        prefs.putUInt("done", i + 1);
+        s.blocksDone = i + 1;
+        setStatus(s);
+    }
+
+    if (!verifyImage(part, *m, scratch)) {
+        prefs.putUInt("done", 0);
+        fail(s, "image hash mismatch");
+        goto cleanup;
+    }
+
+    // esp_ota_set_boot_partition() also validates the app image header
+    if (esp_ota_set_boot_partition(part) != ESP_OK) {
+        prefs.putUInt("done", 0);
+        fail(s, "image rejected by bootloader check");
+        goto cleanup;
+    }
+
+    prefs.clear();
+
+    s.state = UPDATER_DONE;
+    setStatus(s);
+    LOG_INFO("OTA: image verified, rebooting into %s", part->label);
+
+cleanup:
+    prefs.end();
+    free(inflater);
+    free(scratch);
+    free(block);
+    free(compressed);
+    free(m);
+
+    if (s.state == UPDATER_DONE) {
+        // Give the loop a moment to publish the final status
+        delay(3000);
+        ESP.restart();
+    }
+    vTaskDelete(NULL);
+}
+
+bool updaterStart(const char* url) {
+    if (updaterGetStatus().state == UPDATER_RUNNING) return false;
+
+    UpdaterStatus s = {UPDATER_RUNNING, 0, 0, 0, 0, false, nullptr};
+    if (!updaterUrlAllowed(url)) {
+        s.state = UPDATER_FAILED;
+        s.error = "manifest URL not allowed";
+        setStatus(s);
+        LOG_WARN("OTA: manifest URL not allowed");
+        return false;
+    }
+    snprintf(manifestUrl, sizeof(manifestUrl), "%s", url);
+    setStatus(s);
+
+    // Core 0, low priority - inference on core 1 is unaffected apart from
+    // the brief flash cache stalls during erase/write
+    if (xTaskCreatePinnedToCore(updaterTask, "ota", 8192, NULL, 1, NULL, 0) != pdPASS) {
+        s.state = UPDATER_FAILED;
+        s.error = "task create failed";
+        setStatus(s);
+        return false;
+    }
+    return true;
+}
+
+bool updaterResumePending() {
+    Preferences prefs;
+    prefs.begin("ota", true);
+    String url = prefs.getString("url", "");
+    uint32_t done = prefs.getUInt("done", 0);
+    prefs.end();
+
+    if (url.length() == 0 || done == 0) return false;
+    LOG_INFO("OTA: resuming interrupted update (%u blocks done)", done);
+    return updaterStart(url.c_str());
+}
@@ -0,0 +1,66 @@
+#ifndef UPDATER_H
+#define UPDATER_H
+
+#include <Arduino.h>
+
+// ============================================
+// Compressed, resumable HTTP OTA
+// ============================================
+//
+// Pulls a firmware image prepared by scripts/pack_ota.py from an HTTP server
+// (scripts/ota_server.py is a local stand-in). The image is split into
+// fixed-size blocks, each raw-deflate compressed on its own and listed in
+// manifest.json with its SHA-256. Per block:
+//
+//   HTTP Range request -> inflate (ROM miniz) -> check SHA-256 -> write to
+//   the inactive app partition -> read back + re-check -> record progress in NVS
+//
+// A dropped connection or a reboot resumes from the last verified block.
+// When all blocks are in, the whole image hash is checked before the new
+// partition is marked bootable.
+//
+// The download runs in its own task; monitoring keeps going meanwhile.
+//
+// The block hashes only tie the image to its manifest, so the manifest
+// itself has to be trusted: with OTA_PUBLIC_KEY set it must carry a valid
+// ECDSA signature (<manifest URL>.sig, from pack_ota.py --key), otherwise
+// it must come from OTA_MANIFEST_URL's host. A manifest also has to be for
+// a newer FIRMWARE_BUILD than the running one, so an old, validly signed
+// manifest can't be replayed to downgrade the device.
+
+// Release build number. Bump it for every image that goes out over pull
+// OTA; pack_ota.py reads it back out of the image for the manifest.
+#define FIRMWARE_BUILD 1
+
+enum UpdaterState {
+    UPDATER_IDLE,
+    UPDATER_RUNNING,
+    UPDATER_DONE,       // Image verified, rebooting into it
+    UPDATER_FAILED
+};
+
+struct UpdaterStatus {
+    UpdaterState state;
+    uint32_t blocksDone;
+    uint32_t blocksTotal;
+    uint32_t bytesDownloaded;   // Compressed bytes fetched this run
+    uint32_t retries;           // Block fetch/verify retries this run
+    bool resumed;               // Picked up a partial download from NVS
+    const char* error;          // Static string, set when FAILED
+};
+
+// Whether a manifest URL may be used at all (see above)
+bool updaterUrlAllowed(const char* manifestUrl);
+
+// Start an update from a manifest URL. Returns false if one is already
+// running or the URL isn't allowed.
+bool updaterStart(const char* manifestUrl);
+
+// Restart an update that was interrupted by a reboot, if NVS has one.
+// Call once WiFi is up.
+bool updaterResumePending();
+
+// Snapshot of the current progress (safe to call from any task)
+UpdaterStatus updaterGetStatus();
+
+#endif // UPDATER_H